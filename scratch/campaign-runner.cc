@@ -0,0 +1,396 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+/*
+ * Runs an experiment campaign (the grid of seeds x gateways x devices x
+ * strategies of the sandbox/runExperiments*.sh scripts) on a pool of worker
+ * threads sized to the machine. Each worker runs one simulation process at a
+ * time and takes the next run from its own queue, or steals one from the
+ * tail of another worker's queue once its own is empty, so long and short
+ * runs keep every core busy.
+ *
+ * Every finished run is appended to a checkpoint file with its exit status,
+ * wall time and peak RSS; runs already completed there are skipped, so an
+ * interrupted campaign resumes where it stopped.
+ *
+ * The sweep file lists run templates, each followed by the values of its
+ * placeholders (lists and a..b ranges, the first variable varying slowest):
+ *
+ *   run ./ns3.36-density-oriented-experiment-optimized --nDevices={d} --nGateways={g} --seed={s}
+ *   set s 1..50
+ *   set g 1..10
+ *   set d 10
+ *
+ * ./ns3.36-campaign-runner-optimized --sweep=../sandbox/experiments1a50.sweep --jobs=0
+ */
+
+#include "ns3/command-line.h"
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("CampaignRunner");
+
+/**
+ * A run template and the values of its placeholders
+ */
+struct Sweep
+{
+    std::string command;
+    std::vector<std::pair<std::string, std::vector<std::string>>> variables;
+};
+
+/**
+ * Outcome of one run, as logged in the checkpoint file
+ */
+struct RunResult
+{
+    int status;      // exit status, -1 when killed by a signal
+    double wallTime; // s
+    long maxRss;     // peak resident set size (kB)
+};
+
+/**
+ * Run queues of the workers. A worker takes runs from the head of its own
+ * queue and steals from the tail of the others.
+ */
+class WorkStealingQueues
+{
+  public:
+    explicit WorkStealingQueues(uint32_t workers)
+        : m_queues(workers)
+    {
+    }
+
+    /**
+     * Deals the runs round-robin over the queues.
+     */
+    void Deal(const std::vector<size_t>& runs)
+    {
+        for (size_t i = 0; i < runs.size(); ++i)
+        {
+            m_queues[i % m_queues.size()].runs.push_back(runs[i]);
+        }
+    }
+
+    /**
+     * @param worker: index of the calling worker
+     * @param run: set to the next run of the worker
+     * @return false once every queue is empty
+     */
+    bool Next(uint32_t worker, size_t& run)
+    {
+        for (uint32_t k = 0; k < m_queues.size(); ++k)
+        {
+            Queue& queue = m_queues[(worker + k) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.runs.empty())
+            {
+                continue;
+            }
+            if (k == 0)
+            {
+                run = queue.runs.front();
+                queue.runs.pop_front();
+            }
+            else
+            {
+                run = queue.runs.back();
+                queue.runs.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+
+  private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<size_t> runs;
+    };
+
+    std::vector<Queue> m_queues;
+};
+
+/**
+ * @return the values of a "set" line: numbers, a..b ranges or words
+ */
+std::vector<std::string>
+ExpandValues(std::istringstream& in)
+{
+    std::vector<std::string> values;
+    std::string token;
+    while (in >> token)
+    {
+        size_t dots = token.find("..");
+        if (dots == std::string::npos)
+        {
+            values.push_back(token);
+            continue;
+        }
+        long first = std::stol(token.substr(0, dots));
+        long last = std::stol(token.substr(dots + 2));
+        for (long v = first; v <= last; ++v)
+        {
+            values.push_back(std::to_string(v));
+        }
+    }
+    return values;
+}
+
+std::vector<Sweep>
+ReadSweeps(const std::string& filename)
+{
+    std::ifstream in(filename);
+    if (!in)
+    {
+        NS_FATAL_ERROR("Could not open the sweep file " << filename);
+    }
+    std::vector<Sweep> sweeps;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream words(line);
+        std::string keyword;
+        if (!(words >> keyword) || keyword[0] == '#')
+        {
+            continue;
+        }
+        if (keyword == "run")
+        {
+            std::string command;
+            std::getline(words >> std::ws, command);
+            sweeps.push_back(Sweep{command, {}});
+        }
+        else if (keyword == "set" && !sweeps.empty())
+        {
+            std::string name;
+            words >> name;
+            sweeps.back().variables.emplace_back(name, ExpandValues(words));
+        }
+        else
+        {
+            NS_FATAL_ERROR("Unexpected line in " << filename << ": " << line);
+        }
+    }
+    return sweeps;
+}
+
+/**
+ * Appends the commands of a sweep, one per combination of its values.
+ */
+void
+ExpandSweep(const Sweep& sweep, size_t variable, std::string command, std::vector<std::string>& runs)
+{
+    if (variable == sweep.variables.size())
+    {
+        if (command.find('{') != std::string::npos)
+        {
+            NS_FATAL_ERROR("Placeholder without values in: " << command);
+        }
+        runs.push_back(command);
+        return;
+    }
+    const std::string placeholder = "{" + sweep.variables[variable].first + "}";
+    for (const std::string& value : sweep.variables[variable].second)
+    {
+        std::string expanded = command;
+        for (size_t pos = expanded.find(placeholder); pos != std::string::npos;
+             pos = expanded.find(placeholder, pos + value.size()))
+        {
+            expanded.replace(pos, placeholder.size(), value);
+        }
+        ExpandSweep(sweep, variable + 1, expanded, runs);
+    }
+}
+
+/**
+ * @return the commands of the runs that completed successfully in a checkpoint file
+ */
+std::set<std::string>
+ReadCheckpoint(const std::string& filename)
+{
+    std::set<std::string> done;
+    std::ifstream in(filename);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        // status wall rss command, tab separated
+        std::istringstream fields(line);
+        std::string status;
+        std::string wall;
+        std::string rss;
+        std::string command;
+        if (std::getline(fields, status, '\t') && std::getline(fields, wall, '\t') &&
+            std::getline(fields, rss, '\t') && std::getline(fields, command) && status == "0")
+        {
+            done.insert(command);
+        }
+    }
+    return done;
+}
+
+/**
+ * Runs a command through the shell and waits for it.
+ */
+RunResult
+Execute(const std::string& command)
+{
+    // exec: the shell is replaced by the simulation, whose RSS is then the one reported
+    std::string script = "exec " + command;
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execl("/bin/sh", "sh", "-c", script.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    RunResult result{-1, 0, 0};
+    if (pid < 0)
+    {
+        return result;
+    }
+    int status = 0;
+    struct rusage usage = {};
+    while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR)
+    {
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    result.wallTime = elapsed.count();
+    result.maxRss = usage.ru_maxrss;
+    return result;
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string sweepFile = "";
+    std::string checkpointFile = "";
+    uint32_t jobs = 0;
+    bool dryRun = false;
+
+    CommandLine cmd;
+    cmd.AddValue("sweep", "Sweep specification file", sweepFile);
+    cmd.AddValue("checkpoint", "Checkpoint file. Default: <sweep>.done", checkpointFile);
+    cmd.AddValue("jobs", "Simulations running at a time, 0 for the number of CPUs", jobs);
+    cmd.AddValue("dryRun", "Only print the pending runs", dryRun);
+    cmd.Parse(argc, argv);
+
+    if (sweepFile.empty())
+    {
+        NS_FATAL_ERROR("No sweep file, see --sweep");
+    }
+    if (checkpointFile.empty())
+    {
+        checkpointFile = sweepFile + ".done";
+    }
+    if (jobs == 0)
+    {
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<std::string> runs;
+    for (const Sweep& sweep : ReadSweeps(sweepFile))
+    {
+        ExpandSweep(sweep, 0, sweep.command, runs);
+    }
+    std::set<std::string> done = ReadCheckpoint(checkpointFile);
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        if (done.count(runs[i]) == 0)
+        {
+            pending.push_back(i);
+        }
+    }
+    std::cout << runs.size() << " runs, " << runs.size() - pending.size() << " already done, "
+              << jobs << " jobs" << std::endl;
+    if (dryRun)
+    {
+        for (size_t run : pending)
+        {
+            std::cout << runs[run] << std::endl;
+        }
+        return 0;
+    }
+
+    std::ofstream checkpoint(checkpointFile, std::ios::app);
+    if (!checkpoint)
+    {
+        NS_FATAL_ERROR("Could not open the checkpoint file " << checkpointFile);
+    }
+    std::mutex checkpointMutex;
+    std::atomic<uint32_t> failed(0);
+    std::atomic<size_t> finished(0);
+    WorkStealingQueues queues(jobs);
+    queues.Deal(pending);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (uint32_t w = 0; w < jobs; ++w)
+    {
+        workers.emplace_back([&, w]() {
+            size_t run;
+            while (queues.Next(w, run))
+            {
+                RunResult result = Execute(runs[run]);
+                failed += result.status != 0;
+                std::lock_guard<std::mutex> lock(checkpointMutex);
+                // One flushed line per run: the checkpoint survives an interruption
+                checkpoint << result.status << "\t" << std::fixed << std::setprecision(3)
+                           << result.wallTime << "\t" << result.maxRss << "\t" << runs[run]
+                           << std::endl;
+                std::cout << "[" << ++finished << "/" << pending.size() << "] " << std::fixed
+                          << std::setprecision(1) << result.wallTime << " s "
+                          << result.maxRss / 1024 << " MB status " << result.status << ": "
+                          << runs[run] << std::endl;
+            }
+        });
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Runtime was " << std::fixed << std::setprecision(1) << elapsed.count() << " s, "
+              << failed << " failed runs" << std::endl;
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,212 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef COVERAGE_EVALUATOR_H
+#define COVERAGE_EVALUATOR_H
+
+#include "ns3/vector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Smallest set of candidate gateways reaching a given share of the end
+ * devices.
+ *
+ * The reachability of every device from every candidate is computed once:
+ * the devices are binned in a uniform grid with cells as large as the range,
+ * so a candidate only tests the devices of the cells within range of it, and
+ * the exact test (e.g. received power against the SF12 sensitivity) only runs
+ * on those. The cover is then the greedy one, picking at each step the
+ * candidate reaching most uncovered devices. The gains only decrease as
+ * devices get covered, so it is evaluated lazily: candidates sit in a
+ * priority queue under their last known gain and only the top one is
+ * recomputed; when it stays on top it is taken.
+ */
+class CoverageEvaluator
+{
+  public:
+    /**
+     * Exact reachability test of device d from gateway g
+     */
+    using Reach = std::function<bool(uint32_t g, uint32_t d)>;
+
+    /**
+     * Computes the devices reached by each candidate.
+     * @param devices: end device positions
+     * @param gateways: candidate gateway positions
+     * @param range: horizontal distance beyond which no device is reachable
+     * @param reach: test run on the devices within range
+     */
+    void Build(const std::vector<Vector>& devices,
+               const std::vector<Vector>& gateways,
+               double range,
+               Reach reach)
+    {
+        m_devices = devices.size();
+        m_offsets.assign(gateways.size() + 1, 0);
+        m_reached.clear();
+        if (devices.empty())
+        {
+            return;
+        }
+
+        // Devices by grid cell, as a counting sort
+        double minX = devices[0].x;
+        double minY = devices[0].y;
+        double maxX = minX;
+        double maxY = minY;
+        for (const Vector& d : devices)
+        {
+            minX = std::min(minX, d.x);
+            minY = std::min(minY, d.y);
+            maxX = std::max(maxX, d.x);
+            maxY = std::max(maxY, d.y);
+        }
+        double side = std::max(range, 1.0);
+        uint32_t cols = uint32_t((maxX - minX) / side) + 1;
+        uint32_t rows = uint32_t((maxY - minY) / side) + 1;
+        auto cellOf = [&](double x, double y) {
+            return uint64_t((x - minX) / side) * rows + uint32_t((y - minY) / side);
+        };
+        std::vector<uint32_t> cellStart(uint64_t(cols) * rows + 1, 0);
+        for (const Vector& d : devices)
+        {
+            cellStart[cellOf(d.x, d.y) + 1]++;
+        }
+        for (uint64_t c = 0; c < uint64_t(cols) * rows; ++c)
+        {
+            cellStart[c + 1] += cellStart[c];
+        }
+        std::vector<uint32_t> cellDevices(devices.size());
+        std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+        for (uint32_t i = 0; i < devices.size(); ++i)
+        {
+            cellDevices[fill[cellOf(devices[i].x, devices[i].y)]++] = i;
+        }
+
+        for (uint32_t g = 0; g < gateways.size(); ++g)
+        {
+            const Vector& p = gateways[g];
+            // Cells overlapping the square around the candidate, clamped to the grid
+            int64_t c0 = std::max<int64_t>(0, std::floor((p.x - range - minX) / side));
+            int64_t c1 = std::min<int64_t>(cols - 1, std::floor((p.x + range - minX) / side));
+            int64_t r0 = std::max<int64_t>(0, std::floor((p.y - range - minY) / side));
+            int64_t r1 = std::min<int64_t>(rows - 1, std::floor((p.y + range - minY) / side));
+            for (int64_t c = c0; c <= c1; ++c)
+            {
+                for (int64_t r = r0; r <= r1; ++r)
+                {
+                    uint64_t cell = uint64_t(c) * rows + r;
+                    for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; ++k)
+                    {
+                        uint32_t d = cellDevices[k];
+                        double dx = devices[d].x - p.x;
+                        double dy = devices[d].y - p.y;
+                        if (dx * dx + dy * dy <= range * range && reach(g, d))
+                        {
+                            m_reached.push_back(d);
+                        }
+                    }
+                }
+            }
+            m_offsets[g + 1] = m_reached.size();
+        }
+    }
+
+    /**
+     * @return devices reached by gateway g alone
+     */
+    uint32_t GetReached(uint32_t g) const
+    {
+        return m_offsets[g + 1] - m_offsets[g];
+    }
+
+    /**
+     * Greedy cover, until the rate is reached or no candidate adds devices.
+     * @param rate: share of the devices to cover, 0 to 1
+     * @param coverage: if given, set to the share covered after each pick
+     * @return the picked candidates, in order
+     */
+    std::vector<uint32_t> Cover(double rate, std::vector<double>* coverage = nullptr) const
+    {
+        std::vector<uint32_t> picked;
+        if (coverage != nullptr)
+        {
+            coverage->clear();
+        }
+        std::vector<bool> covered(m_devices, false);
+        uint64_t nCovered = 0;
+        // (gain, -candidate): the lowest index wins among equal gains
+        std::priority_queue<std::pair<uint32_t, int64_t>> queue;
+        for (uint32_t g = 0; g + 1 < m_offsets.size(); ++g)
+        {
+            queue.push({GetReached(g), -int64_t(g)});
+        }
+        while (!queue.empty() && nCovered < rate * m_devices)
+        {
+            uint32_t g = -queue.top().second;
+            queue.pop();
+            uint32_t gain = 0;
+            for (uint32_t k = m_offsets[g]; k < m_offsets[g + 1]; ++k)
+            {
+                gain += !covered[m_reached[k]];
+            }
+            if (gain == 0)
+            {
+                continue;
+            }
+            // Stale upper bounds above, or equal with a lower index: evaluate them first
+            if (!queue.empty() && std::make_pair(gain, -int64_t(g)) < queue.top())
+            {
+                queue.push({gain, -int64_t(g)});
+                continue;
+            }
+            for (uint32_t k = m_offsets[g]; k < m_offsets[g + 1]; ++k)
+            {
+                covered[m_reached[k]] = true;
+            }
+            nCovered += gain;
+            picked.push_back(g);
+            if (coverage != nullptr)
+            {
+                coverage->push_back(double(nCovered) / m_devices);
+            }
+        }
+        return picked;
+    }
+
+  private:
+    uint32_t m_devices = 0;
+    std::vector<uint64_t> m_offsets; //!< g reaches m_reached[m_offsets[g] .. m_offsets[g + 1])
+    std::vector<uint32_t> m_reached; //!< devices reached, candidate after candidate
+};
+
+} // namespace ns3
+
+#endif /* COVERAGE_EVALUATOR_H */
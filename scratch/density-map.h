@@ -0,0 +1,454 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef DENSITY_MAP_H
+#define DENSITY_MAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * One cell of a density map
+ */
+struct DensityCell
+{
+    double v;
+    uint32_t w;
+    uint32_t h;
+};
+
+/**
+ * Traffic density raster of the spatial model of Lee et al. ("Spatial
+ * modeling of the traffic density in cellular networks", IEEE Wireless
+ * Communications, 2014), for N random angular frequencies and phases:
+ *
+ *   field(w, h) = 2 / sqrt(N) * sum_i cos(wi_i X_w + phi_i) cos(wj_i Y_h + psi_i)
+ *   p(w, h)     = exp(sigma * field(w, h) + mu)
+ *
+ * The products are separable: the cosine factors of every column X_w and
+ * every row Y_h are computed once, N (W + H) cosines in all, so a cell costs
+ * N multiply-adds and one exponential, both in loops the compiler vectorizes
+ * along a row. Rows are handed to the threads in tiles and the total is
+ * summed per row, so the result does not depend on the number of threads.
+ *
+ * The raster (W x H doubles, cell (w, h) at w * H + h) lives on the heap or
+ * in a mapped file, read back by Open () and by density_map.py:
+ *
+ *   header   magic "DMAP", version, W, H, cell side (double), total density (double)
+ *   data     the W x H densities
+ */
+class DensityMap
+{
+  public:
+    static constexpr uint32_t MAGIC = 0x50414d44; // "DMAP"
+    static constexpr uint32_t VERSION = 1;
+
+    DensityMap() = default;
+    DensityMap(const DensityMap&) = delete;
+    DensityMap& operator=(const DensityMap&) = delete;
+
+    ~DensityMap()
+    {
+        Release();
+    }
+
+    /**
+     * Allocates the raster.
+     * @param width: cells along X
+     * @param height: cells along Y
+     * @param cellSide: cell height and width in meters
+     * @param filename: file the raster is mapped to, on the heap when empty
+     * @return false when the file cannot be created or mapped
+     */
+    bool Allocate(uint32_t width, uint32_t height, double cellSide, const std::string& filename)
+    {
+        Release();
+        uint64_t cells = uint64_t(width) * height;
+        if (filename.empty())
+        {
+            m_heap.assign(cells, 0);
+            m_data = m_heap.data();
+        }
+        else
+        {
+            int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+            {
+                return false;
+            }
+            size_t size = sizeof(Header) + cells * sizeof(double);
+            void* base = MAP_FAILED;
+            if (ftruncate(fd, size) == 0)
+            {
+                base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            close(fd);
+            if (base == MAP_FAILED)
+            {
+                return false;
+            }
+            m_mapped = static_cast<char*>(base);
+            m_mappedSize = size;
+            m_data = reinterpret_cast<double*>(m_mapped + sizeof(Header));
+        }
+        m_width = width;
+        m_height = height;
+        m_cellSide = cellSide;
+        m_total = 0;
+        WriteHeader();
+        return true;
+    }
+
+    /**
+     * Maps a raster written by an earlier run, copy-on-write: the file is
+     * never modified. GetField () is not available on an opened map.
+     * @return false when the file cannot be mapped or is not a density map
+     */
+    bool Open(const std::string& filename)
+    {
+        Release();
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        void* base = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(Header))
+        {
+            base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (base == MAP_FAILED)
+        {
+            return false;
+        }
+        m_mapped = static_cast<char*>(base);
+        m_mappedSize = st.st_size;
+        Header header;
+        std::memcpy(&header, m_mapped, sizeof(header));
+        if (header.magic != MAGIC || header.version != VERSION ||
+            sizeof(Header) + uint64_t(header.width) * header.height * sizeof(double) > m_mappedSize)
+        {
+            Release();
+            return false;
+        }
+        m_data = reinterpret_cast<double*>(m_mapped + sizeof(Header));
+        m_width = header.width;
+        m_height = header.height;
+        m_cellSide = header.cellSide;
+        m_total = header.total;
+        return true;
+    }
+
+    /**
+     * Evaluates the model on every cell. The cell centers are at
+     * X_w = (w - 0.5) cellSide and Y_h = (h - 0.5) cellSide.
+     * @param angFreqI, angFreqJ, phasePhi, phasePsi: the N terms of the model
+     * @param mu, sigma: log-normal parameters
+     * @param threads: worker threads, the hardware concurrency when 0
+     */
+    void Compute(const std::vector<double>& angFreqI,
+                 const std::vector<double>& angFreqJ,
+                 const std::vector<double>& phasePhi,
+                 const std::vector<double>& phasePsi,
+                 double mu,
+                 double sigma,
+                 uint32_t threads)
+    {
+        m_terms = angFreqI.size();
+        m_scale = 2 / std::sqrt(double(m_terms));
+        m_cosX.resize(uint64_t(m_terms) * m_width);
+        m_cosY.resize(uint64_t(m_terms) * m_height);
+        for (uint32_t i = 0; i < m_terms; ++i)
+        {
+            for (uint32_t w = 0; w < m_width; ++w)
+            {
+                double x = w * m_cellSide - 0.5 * m_cellSide;
+                m_cosX[uint64_t(i) * m_width + w] = std::cos(angFreqI[i] * x + phasePhi[i]);
+            }
+            for (uint32_t h = 0; h < m_height; ++h)
+            {
+                double y = h * m_cellSide - 0.5 * m_cellSide;
+                m_cosY[uint64_t(i) * m_height + h] = std::cos(angFreqJ[i] * y + phasePsi[i]);
+            }
+        }
+
+        if (threads == 0)
+        {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = std::max(1u, std::min(threads, (m_width + TILE_ROWS - 1) / TILE_ROWS));
+        std::vector<double> rowTotals(m_width);
+        std::atomic<uint32_t> nextTile(0);
+        auto worker = [&]() {
+            for (uint32_t first = TILE_ROWS * nextTile++; first < m_width;
+                 first = TILE_ROWS * nextTile++)
+            {
+                for (uint32_t w = first; w < std::min(m_width, first + TILE_ROWS); ++w)
+                {
+                    rowTotals[w] = ComputeRow(w, mu, sigma);
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (uint32_t t = 1; t < threads; ++t)
+        {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& t : pool)
+        {
+            t.join();
+        }
+
+        m_total = 0;
+        for (double rowTotal : rowTotals)
+        {
+            m_total += rowTotal;
+        }
+        WriteHeader();
+    }
+
+    uint32_t GetWidth() const
+    {
+        return m_width;
+    }
+
+    uint32_t GetHeight() const
+    {
+        return m_height;
+    }
+
+    double GetCellSide() const
+    {
+        return m_cellSide;
+    }
+
+    /**
+     * @return the W x H densities, cell (w, h) at w * H + h
+     */
+    const double* GetData() const
+    {
+        return m_data;
+    }
+
+    /**
+     * @return the density p(w, h)
+     */
+    double Get(uint32_t w, uint32_t h) const
+    {
+        return m_data[uint64_t(w) * m_height + h];
+    }
+
+    /**
+     * @return the normalized field(w, h) the density of the cell comes from
+     */
+    double GetField(uint32_t w, uint32_t h) const
+    {
+        double sum = 0;
+        for (uint32_t i = 0; i < m_terms; ++i)
+        {
+            sum = sum + m_cosX[uint64_t(i) * m_width + w] * m_cosY[uint64_t(i) * m_height + h];
+        }
+        return m_scale * sum;
+    }
+
+    /**
+     * @return sum of the densities of all cells
+     */
+    double GetTotal() const
+    {
+        return m_total;
+    }
+
+    /**
+     * The densest cells, found in one pass with a bounded min-heap instead of
+     * sorting the whole raster.
+     * @param k: number of cells
+     * @return min(k, W x H) cells, densest first
+     */
+    std::vector<DensityCell> GetDensest(uint32_t k) const
+    {
+        auto denser = [](const DensityCell& a, const DensityCell& b) { return a.v > b.v; };
+        std::vector<DensityCell> heap;
+        heap.reserve(std::min(uint64_t(k), uint64_t(m_width) * m_height));
+        for (uint32_t w = 0; w < m_width && k > 0; ++w)
+        {
+            const double* row = m_data + uint64_t(w) * m_height;
+            for (uint32_t h = 0; h < m_height; ++h)
+            {
+                if (heap.size() < k)
+                {
+                    heap.push_back({row[h], w, h});
+                    std::push_heap(heap.begin(), heap.end(), denser);
+                }
+                else if (row[h] > heap.front().v)
+                {
+                    std::pop_heap(heap.begin(), heap.end(), denser);
+                    heap.back() = {row[h], w, h};
+                    std::push_heap(heap.begin(), heap.end(), denser);
+                }
+            }
+        }
+        std::sort_heap(heap.begin(), heap.end(), denser);
+        return heap;
+    }
+
+    /**
+     * out[j] = exp(in[j]) for |in[j]| < 700, within 1 ulp of std::exp.
+     *
+     * exp(x) = 2^k exp(r), with k = round(x / ln 2) and |r| <= ln 2 / 2:
+     * the rounding and the 2^k scale are done on the bits of the double, and
+     * exp(r) by its Taylor series to degree 13, so the loop has no branch nor
+     * library call and is vectorized.
+     */
+    static void Exp(const double* in, double* out, uint64_t n)
+    {
+        const double shifter = 6755399441055744.0; // 1.5 * 2^52: x + shifter rounds x
+        const int64_t shifterBits = 0x4338000000000000;
+        const double log2e = 1.4426950408889634;
+        const double ln2Hi = 6.93147180369123816490e-01;
+        const double ln2Lo = 1.90821492927058770002e-10;
+        for (uint64_t j = 0; j < n; ++j)
+        {
+            double t = in[j] * log2e + shifter;
+            double k = t - shifter;
+            double r = (in[j] - k * ln2Hi) - k * ln2Lo;
+            double p = 1.0 / 6227020800;
+            p = p * r + 1.0 / 479001600;
+            p = p * r + 1.0 / 39916800;
+            p = p * r + 1.0 / 3628800;
+            p = p * r + 1.0 / 362880;
+            p = p * r + 1.0 / 40320;
+            p = p * r + 1.0 / 5040;
+            p = p * r + 1.0 / 720;
+            p = p * r + 1.0 / 120;
+            p = p * r + 1.0 / 24;
+            p = p * r + 1.0 / 6;
+            p = p * r + 0.5;
+            p = p * r + 1.0;
+            p = p * r + 1.0;
+            int64_t bits;
+            std::memcpy(&bits, &t, sizeof(bits));
+            bits = (bits - shifterBits + 1023) << 52;
+            double scale;
+            std::memcpy(&scale, &bits, sizeof(scale));
+            out[j] = p * scale;
+        }
+    }
+
+  private:
+    static constexpr uint32_t TILE_ROWS = 16;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        double cellSide;
+        double total;
+    };
+
+    /**
+     * Fills row w of the raster.
+     * @return sum of the densities of the row
+     */
+    double ComputeRow(uint32_t w, double mu, double sigma)
+    {
+        double* row = m_data + uint64_t(w) * m_height;
+        std::fill(row, row + m_height, 0.0);
+        for (uint32_t i = 0; i < m_terms; ++i)
+        {
+            double cx = m_cosX[uint64_t(i) * m_width + w];
+            const double* cy = m_cosY.data() + uint64_t(i) * m_height;
+            for (uint32_t h = 0; h < m_height; ++h)
+            {
+                row[h] = row[h] + cx * cy[h];
+            }
+        }
+        for (uint32_t h = 0; h < m_height; ++h)
+        {
+            row[h] = sigma * (m_scale * row[h]) + mu;
+        }
+        Exp(row, row, m_height);
+        double total = 0;
+        for (uint32_t h = 0; h < m_height; ++h)
+        {
+            total += row[h];
+        }
+        return total;
+    }
+
+    void WriteHeader()
+    {
+        if (m_mapped != nullptr)
+        {
+            Header header = {MAGIC, VERSION, m_width, m_height, m_cellSide, m_total};
+            std::memcpy(m_mapped, &header, sizeof(header));
+        }
+    }
+
+    void Release()
+    {
+        if (m_mapped != nullptr)
+        {
+            munmap(m_mapped, m_mappedSize);
+            m_mapped = nullptr;
+        }
+        m_heap.clear();
+        m_heap.shrink_to_fit();
+        m_data = nullptr;
+        m_width = 0;
+        m_height = 0;
+        m_terms = 0;
+    }
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    double m_cellSide = 0;
+    double m_total = 0;
+    double* m_data = nullptr;
+    std::vector<double> m_heap;
+    char* m_mapped = nullptr;
+    size_t m_mappedSize = 0;
+    uint32_t m_terms = 0;
+    double m_scale = 0;
+    std::vector<double> m_cosX; //!< N x W column factors
+    std::vector<double> m_cosY; //!< N x H row factors
+};
+
+} // namespace ns3
+
+#endif /* DENSITY_MAP_H */
@@ -0,0 +1,323 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef DENSITY_QUADTREE_H
+#define DENSITY_QUADTREE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Density-oriented gateway placement over a device histogram of any size.
+ *
+ * The histogram (devices per cell of a W x H grid) is turned into two
+ * summed-area tables, of devices and of cells holding devices, so the sums
+ * over any rectangle cost four lookups. The grid is then split as a quadtree,
+ * halving both sides at each level down to single cells, and the gateways are
+ * handed down: a node splits its gateways among its children in proportion
+ * to their devices (largest remainder first, denser children first on ties),
+ * never giving a child more gateways than it has cells with devices. Each
+ * cell reached with a gateway gets one, at its center.
+ *
+ * The subtrees of a node are independent once their gateways are known, so
+ * the top levels are split first and the subtrees below them are handed to
+ * a fixed number of threads; the result, listed in tree order (denser
+ * children first), does not depend on their number.
+ */
+class DensityQuadtree
+{
+  public:
+    /**
+     * A cell of the grid
+     */
+    struct Cell
+    {
+        uint32_t w;
+        uint32_t h;
+    };
+
+    DensityQuadtree(uint32_t width, uint32_t height)
+        : m_width(width),
+          m_height(height),
+          m_devices(uint64_t(width + 1) * (height + 1)),
+          m_occupied(uint64_t(width + 1) * (height + 1))
+    {
+    }
+
+    uint32_t GetWidth() const
+    {
+        return m_width;
+    }
+
+    uint32_t GetHeight() const
+    {
+        return m_height;
+    }
+
+    /**
+     * Counts one device in cell (w, h). Call Build () once all are added.
+     */
+    void Add(uint32_t w, uint32_t h)
+    {
+        m_devices[Index(w + 1, h + 1)]++;
+    }
+
+    /**
+     * Turns the histogram into the summed-area tables.
+     */
+    void Build()
+    {
+        for (uint32_t w = 1; w <= m_width; ++w)
+        {
+            for (uint32_t h = 1; h <= m_height; ++h)
+            {
+                uint64_t i = Index(w, h);
+                uint64_t up = Index(w - 1, h);
+                uint64_t left = Index(w, h - 1);
+                uint64_t corner = Index(w - 1, h - 1);
+                m_occupied[i] = (m_devices[i] > 0) + m_occupied[up] + m_occupied[left] -
+                                m_occupied[corner];
+                m_devices[i] += m_devices[up] + m_devices[left] - m_devices[corner];
+            }
+        }
+    }
+
+    /**
+     * @return devices in cells [w0, w1) x [h0, h1)
+     */
+    uint64_t Devices(uint32_t w0, uint32_t h0, uint32_t w1, uint32_t h1) const
+    {
+        return Sum(m_devices, w0, h0, w1, h1);
+    }
+
+    /**
+     * @return cells holding devices in [w0, w1) x [h0, h1)
+     */
+    uint64_t Occupied(uint32_t w0, uint32_t h0, uint32_t w1, uint32_t h1) const
+    {
+        return Sum(m_occupied, w0, h0, w1, h1);
+    }
+
+    /**
+     * Places the gateways.
+     * @param gateways: number of gateways; at most one per cell holding devices
+     * is placed
+     * @param threads: threads placing the subtrees below the top levels
+     * @return the cells of the gateways
+     */
+    std::vector<Cell> Allocate(uint32_t gateways, uint32_t threads) const
+    {
+        std::vector<Cell> cells;
+        Node root = {0, 0, m_width, m_height, 0, 0};
+        root.devices = Devices(0, 0, m_width, m_height);
+        root.capacity = Occupied(0, 0, m_width, m_height);
+        uint64_t quota = std::min<uint64_t>(gateways, root.capacity);
+        if (threads <= 1)
+        {
+            Allocate(root, quota, cells);
+            return cells;
+        }
+
+        // One level more than needed for a subtree per thread, to even out the
+        // work of the threads
+        uint32_t splitDepth = 1;
+        for (uint32_t t = 1; t < threads; t *= 4)
+        {
+            ++splitDepth;
+        }
+        std::vector<std::pair<Node, uint64_t>> tasks;
+        Split(root, quota, splitDepth, tasks);
+        std::vector<std::vector<Cell>> parts(tasks.size());
+        std::atomic<uint32_t> next(0);
+        auto worker = [&]() {
+            for (uint32_t i = next++; i < tasks.size(); i = next++)
+            {
+                Allocate(tasks[i].first, tasks[i].second, parts[i]);
+            }
+        };
+        std::vector<std::thread> pool;
+        for (uint32_t t = 1; t < std::min<uint64_t>(threads, tasks.size()); ++t)
+        {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& t : pool)
+        {
+            t.join();
+        }
+        for (const std::vector<Cell>& part : parts)
+        {
+            cells.insert(cells.end(), part.begin(), part.end());
+        }
+        return cells;
+    }
+
+  private:
+    /**
+     * Rectangle [w0, w1) x [h0, h1) of the tree with its sums
+     */
+    struct Node
+    {
+        uint32_t w0;
+        uint32_t h0;
+        uint32_t w1;
+        uint32_t h1;
+        uint64_t devices;
+        uint64_t capacity;
+    };
+
+    uint64_t Index(uint32_t w, uint32_t h) const
+    {
+        return uint64_t(w) * (m_height + 1) + h;
+    }
+
+    uint64_t Sum(const std::vector<uint64_t>& table,
+                 uint32_t w0,
+                 uint32_t h0,
+                 uint32_t w1,
+                 uint32_t h1) const
+    {
+        return table[Index(w1, h1)] - table[Index(w0, h1)] - table[Index(w1, h0)] +
+               table[Index(w0, h0)];
+    }
+
+    /**
+     * Places quota gateways inside node, quota <= node.capacity.
+     */
+    void Allocate(const Node& node, uint64_t quota, std::vector<Cell>& cells) const
+    {
+        if (quota == 0)
+        {
+            return;
+        }
+        if (node.w1 - node.w0 == 1 && node.h1 - node.h0 == 1)
+        {
+            cells.push_back({node.w0, node.h0});
+            return;
+        }
+        std::vector<Node> children;
+        std::vector<uint64_t> shares;
+        Share(node, quota, children, shares);
+        for (uint32_t k = 0; k < children.size(); ++k)
+        {
+            Allocate(children[k], shares[k], cells);
+        }
+    }
+
+    /**
+     * Hands the gateways down depth levels, listing in tree order the nodes
+     * reached there (or single cells reached before) with their quotas.
+     */
+    void Split(const Node& node,
+               uint64_t quota,
+               uint32_t depth,
+               std::vector<std::pair<Node, uint64_t>>& tasks) const
+    {
+        if (quota == 0)
+        {
+            return;
+        }
+        if (depth == 0 || (node.w1 - node.w0 == 1 && node.h1 - node.h0 == 1))
+        {
+            tasks.emplace_back(node, quota);
+            return;
+        }
+        std::vector<Node> children;
+        std::vector<uint64_t> shares;
+        Share(node, quota, children, shares);
+        for (uint32_t k = 0; k < children.size(); ++k)
+        {
+            Split(children[k], shares[k], depth - 1, tasks);
+        }
+    }
+
+    /**
+     * Splits the quota of a node larger than one cell among its children.
+     * @param children: set to the children holding devices, densest first
+     * @param shares: set to the gateways of each child
+     */
+    void Share(const Node& node,
+               uint64_t quota,
+               std::vector<Node>& children,
+               std::vector<uint64_t>& shares) const
+    {
+        uint32_t wm = node.w1 - node.w0 > 1 ? (node.w0 + node.w1) / 2 : node.w1;
+        uint32_t hm = node.h1 - node.h0 > 1 ? (node.h0 + node.h1) / 2 : node.h1;
+        for (Node child : {Node{node.w0, node.h0, wm, hm, 0, 0},
+                           Node{wm, node.h0, node.w1, hm, 0, 0},
+                           Node{node.w0, hm, wm, node.h1, 0, 0},
+                           Node{wm, hm, node.w1, node.h1, 0, 0}})
+        {
+            if (child.w0 < child.w1 && child.h0 < child.h1)
+            {
+                child.devices = Devices(child.w0, child.h0, child.w1, child.h1);
+                child.capacity = Occupied(child.w0, child.h0, child.w1, child.h1);
+                if (child.capacity > 0)
+                {
+                    children.push_back(child);
+                }
+            }
+        }
+        std::stable_sort(children.begin(), children.end(), [](const Node& a, const Node& b) {
+            return a.devices > b.devices;
+        });
+
+        // Largest remainder split of the quota, bounded by the capacities
+        shares.assign(children.size(), 0);
+        std::vector<double> ideal(children.size());
+        uint64_t left = quota;
+        for (uint32_t k = 0; k < children.size(); ++k)
+        {
+            ideal[k] = double(quota) * children[k].devices / node.devices;
+            shares[k] = std::min<uint64_t>(ideal[k], children[k].capacity);
+            left -= shares[k];
+        }
+        while (left > 0)
+        {
+            int best = -1;
+            for (uint32_t k = 0; k < children.size(); ++k)
+            {
+                if (shares[k] < children[k].capacity &&
+                    (best < 0 || ideal[k] - shares[k] > ideal[best] - shares[best]))
+                {
+                    best = k;
+                }
+            }
+            shares[best]++;
+            left--;
+        }
+    }
+
+    uint32_t m_width;
+    uint32_t m_height;
+    std::vector<uint64_t> m_devices;  //!< summed-area table of the devices per cell
+    std::vector<uint64_t> m_occupied; //!< summed-area table of the cells holding devices
+};
+
+} // namespace ns3
+
+#endif /* DENSITY_QUADTREE_H */
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Reader of the density map files written by DensityMap (density-map.h), e.g. by
+devices-density-oriented-distrib --densityMap=<file>.
+
+As a module, the map is mapped, not read:
+    from density_map import read_density_map
+    density, cell_side, total = read_density_map("trafficDensity_1.map")  # (W, H) array
+
+As a script, prints the map size and, with --png, saves a log-scale image of it:
+    python3 density_map.py --png density.png trafficDensity_1.map
+"""
+
+import argparse
+
+import numpy as np
+
+__author__ = "Rogério S. Silva"
+__copyright__ = "Copyright (c) 2023, NumbERS - Federal Institute of Goiás, Inhumas - IFG"
+__version__ = "0.1.0"
+__email__ = "rogerio.sousa@ifg.edu.br"
+
+MAGIC = 0x50414d44
+VERSION = 1
+HEADER = np.dtype([("magic", "<u4"), ("version", "<u4"), ("width", "<u4"), ("height", "<u4"),
+                   ("cellSide", "<f8"), ("total", "<f8")])
+
+
+def read_density_map(filename):
+    """
+    :return: read-only (W, H) memory map of the densities, cell side in meters and total density
+    """
+    header = np.fromfile(filename, dtype=HEADER, count=1)
+    if len(header) == 0 or header["magic"][0] != MAGIC or header["version"][0] != VERSION:
+        raise ValueError(filename + " is not a density map")
+    shape = (int(header["width"][0]), int(header["height"][0]))
+    density = np.memmap(filename, dtype="<f8", mode="r", offset=HEADER.itemsize, shape=shape)
+    return density, float(header["cellSide"][0]), float(header["total"][0])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", help="density map file")
+    parser.add_argument("--png", help="save a log-scale image of the map")
+    args = parser.parse_args()
+
+    density, cell_side, total = read_density_map(args.map)
+    print("%d x %d cells of %g m, total density %g" % (density.shape[0], density.shape[1], cell_side, total))
+    if args.png:
+        import matplotlib.pyplot as plt
+        # Rows of the image are Y, so the map is shown as in the placement plots
+        plt.imshow(np.log(density.T), origin="lower", cmap="viridis",
+                   extent=(0, density.shape[0] * cell_side, 0, density.shape[1] * cell_side))
+        plt.colorbar(label="log density")
+        plt.savefig(args.png, dpi=150)
+
+
+if __name__ == "__main__":
+    main()
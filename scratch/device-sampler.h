@@ -0,0 +1,194 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef DEVICE_SAMPLER_H
+#define DEVICE_SAMPLER_H
+
+#include "density-map.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Philox4x32-10 counter-based generator (Salmon et al., "Parallel random
+ * numbers: as easy as 1, 2, 3", SC 2011): four random words that depend only
+ * on a 128-bit counter and a 64-bit key, so any draw can be made by any
+ * thread in any order.
+ */
+struct Philox
+{
+    uint32_t r[4];
+
+    Philox(uint64_t key, uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3)
+    {
+        uint32_t k0 = uint32_t(key);
+        uint32_t k1 = uint32_t(key >> 32);
+        r[0] = c0;
+        r[1] = c1;
+        r[2] = c2;
+        r[3] = c3;
+        for (int round = 0; round < 10; ++round)
+        {
+            uint64_t p0 = uint64_t(0xD2511F53) * r[0];
+            uint64_t p1 = uint64_t(0xCD9E8D57) * r[2];
+            uint32_t x0 = uint32_t(p1 >> 32) ^ r[1] ^ k0;
+            uint32_t x2 = uint32_t(p0 >> 32) ^ r[3] ^ k1;
+            r[0] = x0;
+            r[1] = uint32_t(p1);
+            r[2] = x2;
+            r[3] = uint32_t(p0);
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+    }
+
+    /**
+     * @return r[i] as a double in (0, 1)
+     */
+    double Uniform(int i) const
+    {
+        return (r[i] + 0.5) * (1.0 / 4294967296.0);
+    }
+};
+
+/**
+ * Draws end device positions straight from a density map: a cell with
+ * probability density / total (Walker's alias method, one table lookup per
+ * device), then a uniform point inside the cell at a height of 1 to 3 m.
+ *
+ * Device i only depends on (seed, i): it takes the words of the Philox blocks
+ * at counters (i, 0) and (i, 1), so a population is the same whatever the
+ * number of threads drawing it and in whatever order.
+ */
+class DeviceSampler
+{
+  public:
+    /**
+     * Builds the alias table of the map (Vose's method, linear time). Holds
+     * 8 bytes per cell; about 20 while building.
+     */
+    explicit DeviceSampler(const DensityMap& map)
+        : m_height(map.GetHeight()),
+          m_cellSide(map.GetCellSide()),
+          m_cells(uint64_t(map.GetWidth()) * map.GetHeight()),
+          m_table(m_cells)
+    {
+        const double* density = map.GetData();
+        double total = 0;
+        for (uint64_t c = 0; c < m_cells; ++c)
+        {
+            total += density[c];
+        }
+
+        // Cells below the mean fill the worklist from the front, the others from the back
+        std::vector<double> scaled(m_cells);
+        std::vector<uint32_t> work(m_cells);
+        uint64_t small = 0;
+        uint64_t large = m_cells;
+        for (uint64_t c = 0; c < m_cells; ++c)
+        {
+            scaled[c] = density[c] * m_cells / total;
+            if (scaled[c] < 1)
+            {
+                work[small++] = c;
+            }
+            else
+            {
+                work[--large] = c;
+            }
+        }
+        // Each small cell is topped up to the mean by a large one, which then
+        // may become small itself
+        uint64_t nextSmall = 0;
+        while (nextSmall < small && large < m_cells)
+        {
+            uint32_t s = work[nextSmall++];
+            uint32_t l = work[large];
+            m_table[s].threshold = Threshold(scaled[s]);
+            m_table[s].alias = l;
+            scaled[l] = (scaled[l] + scaled[s]) - 1;
+            if (scaled[l] < 1)
+            {
+                // l leaves the large end and joins the small ones; the slot
+                // freed by s keeps the small ones contiguous
+                ++large;
+                work[--nextSmall] = l;
+            }
+        }
+        // Left-overs are full up to rounding
+        for (uint64_t i = nextSmall; i < small; ++i)
+        {
+            m_table[work[i]] = {UINT32_MAX, work[i]};
+        }
+        for (uint64_t i = large; i < m_cells; ++i)
+        {
+            m_table[work[i]] = {UINT32_MAX, work[i]};
+        }
+    }
+
+    /**
+     * Position of device i.
+     * @param seed: population seed
+     * @param i: device index
+     * @param xyz: set to x y z
+     */
+    void Sample(uint64_t seed, uint64_t i, double xyz[3]) const
+    {
+        Philox a(seed, uint32_t(i), uint32_t(i >> 32), 0, 0);
+        Philox b(seed, uint32_t(i), uint32_t(i >> 32), 1, 0);
+        uint64_t c = (uint64_t(a.r[0]) * m_cells) >> 32;
+        if (a.r[1] >= m_table[c].threshold)
+        {
+            c = m_table[c].alias;
+        }
+        xyz[0] = (c / m_height + a.Uniform(2)) * m_cellSide;
+        xyz[1] = (c % m_height + a.Uniform(3)) * m_cellSide;
+        xyz[2] = 1 + 2 * b.Uniform(0);
+    }
+
+  private:
+    /**
+     * Cell c is kept when the coin word is below the threshold, its alias
+     * taken otherwise
+     */
+    struct Entry
+    {
+        uint32_t threshold;
+        uint32_t alias;
+    };
+
+    static uint32_t Threshold(double probability)
+    {
+        return uint32_t(std::min(probability * 4294967296.0, 4294967295.0));
+    }
+
+    uint32_t m_height;
+    double m_cellSide;
+    uint64_t m_cells;
+    std::vector<Entry> m_table;
+};
+
+} // namespace ns3
+
+#endif /* DEVICE_SAMPLER_H */
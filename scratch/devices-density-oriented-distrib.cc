@@ -30,6 +30,7 @@
 #include "ns3/core-module.h"
 #include "ns3/lorawan-module.h"
 #include "ns3/propagation-module.h"
+#include "density-map.h"
 #include <algorithm>
 #include <iomanip>
 
@@ -38,25 +39,17 @@ using namespace lorawan;
 
 NS_LOG_COMPONENT_DEFINE ("DevicesDensityOrientedPlacement");
 
-struct pos
-{
-  double v;
-  int w;
-  int h;
-};
-
-bool
-pos_compare (const pos &p1, const pos &p2)
-{
-  return p1.v > p2.v;
-}
-
 int
 main (int argc, char *argv[])
 {
   int nDevices = 0;
   int seed = 1;
   bool printTrafficDensity = false;
+  double areaWidth = 10000;
+  double areaHeight = 10000;
+  double pixSideLen = 2000;
+  uint32_t threads = 0;
+  std::string densityMapFile = "";
 
   CommandLine cmd;
   cmd.AddValue ("nDevices", "Number of end devices to include in the simulation", nDevices);
@@ -64,6 +57,12 @@ main (int argc, char *argv[])
   cmd.AddValue ("printTrafficDensity",
                 "Whether to print traffic density values to graphic validation ",
                 printTrafficDensity);
+  cmd.AddValue ("areaWidth", "Area width in meters", areaWidth);
+  cmd.AddValue ("areaHeight", "Area height in meters", areaHeight);
+  cmd.AddValue ("pixSideLen", "Side of the density map cells in meters", pixSideLen);
+  cmd.AddValue ("threads", "Threads computing the density map (0: one per core)", threads);
+  cmd.AddValue ("densityMap", "File the density map is mapped to instead of the heap",
+                densityMapFile);
   cmd.Parse (argc, argv);
 
   ns3::RngSeedManager::SetSeed (seed);
@@ -95,17 +94,20 @@ main (int argc, char *argv[])
 
   struct densityParams
   {
-    double area_width = 10000; // Area width in meters
-    double area_height = 10000; // Area height in meters
-    double pixSideLen = 2000; // Cell height and width
+    double area_width; // Area width in meters
+    double area_height; // Area height in meters
+    double pixSideLen; // Cell height and width
     double mu = 17.7956;
     double sigma = 2.1188;
     double w_max = 0.012673;
   };
 
   densityParams dParams;
+  dParams.area_width = areaWidth;
+  dParams.area_height = areaHeight;
+  dParams.pixSideLen = pixSideLen;
   double a, b;
-  double angFreq_i[10], angFreq_j[10], phase_phi[10], phase_psi[10];
+  std::vector<double> angFreq_i (10), angFreq_j (10), phase_phi (10), phase_psi (10);
 
   Ptr<UniformRandomVariable> rd = CreateObject<UniformRandomVariable> ();
   rd->SetAttribute ("Min", DoubleValue (0.0));
@@ -124,72 +126,48 @@ main (int argc, char *argv[])
     }
 
   // Compute cell density
-  int ppW = floor (dParams.area_width / dParams.pixSideLen);
-  int ppH = floor (dParams.area_height / dParams.pixSideLen);
-  double Xwh, Ywh, cum_pGwh, totDens = 0.0;
-  double pGwh[ppW][ppH];
-  double p_wh[ppW][ppH];
-  for (int w = 0; w < ppW; w++)
+  uint32_t ppW = floor (dParams.area_width / dParams.pixSideLen);
+  uint32_t ppH = floor (dParams.area_height / dParams.pixSideLen);
+  DensityMap densityMap;
+  if (!densityMap.Allocate (ppW, ppH, dParams.pixSideLen, densityMapFile))
     {
-      for (int h = 0; h < ppH; h++)
-        {
-          Xwh = w * dParams.pixSideLen - 0.5 * dParams.pixSideLen;
-          Ywh = h * dParams.pixSideLen - 0.5 * dParams.pixSideLen;
-          cum_pGwh = 0;
-          for (int i = 0; i < 10; i++)
-            {
-              cum_pGwh = cum_pGwh + cos (angFreq_i[i] * Xwh + phase_phi[i]) *
-                                        cos (angFreq_j[i] * Ywh + phase_psi[i]);
-            }
-          pGwh[w][h] = (2 / sqrt (10)) * cum_pGwh;
-          p_wh[w][h] = exp (dParams.sigma * pGwh[w][h] + dParams.mu);
-          totDens = totDens + p_wh[w][h];
-        }
+      NS_FATAL_ERROR ("Could not map the density map file " << densityMapFile);
     }
-
-  // Normalize cell values to nDevices
-  double pN_wh[ppW][ppH]; // Percentage of devices per cell
-  double nDev[ppW][ppH]; // Number of devices per cell
-  std::vector<pos> vecPos;
-  for (int w = 0; w < ppW; w++)
+  densityMap.Compute (angFreq_i, angFreq_j, phase_phi, phase_psi, dParams.mu, dParams.sigma,
+                      threads);
+  double totDens = densityMap.GetTotal ();
+
+  // Normalize cell values to nDevices. Every cell that gets devices gets at least one, so
+  // only the nDevices densest cells are needed, densest first
+  std::vector<DensityCell> vecPos = densityMap.GetDensest (nDevices);
+  for (DensityCell &cell : vecPos)
     {
-      for (int h = 0; h < ppH; h++)
-        {
-          pN_wh[w][h] = (p_wh[w][h]) / totDens;
-          nDev[w][h] = (pN_wh[w][h] * nDevices);
-          vecPos.push_back ({nDev[w][h], w, h});
-        }
+      cell.v = (cell.v / totDens) * nDevices;
     }
 
-  // order the densest first
-  std::sort (vecPos.begin (), vecPos.end (), pos_compare);
-  int lastPos, nElements;
-  for (lastPos = 0, nElements = 0; vecPos[lastPos].v != 0; lastPos++, nElements+=((int)vecPos[lastPos].v))
-    ;
-
   // Put the devices in the respective cells
-  NodeContainer tmpDevices[lastPos];
   NodeContainer devicesContainer;
-  MobilityHelper tmpMobility[lastPos];
-  int posFactor = (int) dParams.area_height / ppH;
+  double side = dParams.pixSideLen;
   int devPosit = 0, devToPos;
-  for (int x = 0; x < lastPos && nDevices-devPosit > 0; x++)
+  for (uint32_t x = 0; x < vecPos.size () && nDevices - devPosit > 0; x++)
     {
-      devToPos = round(vecPos[x].v)>0?(int) round(vecPos[x].v):1;
-      tmpDevices[x].Create (devToPos);
-      devPosit+=devToPos;
-      tmpMobility[x].SetPositionAllocator (
+      devToPos = round (vecPos[x].v) > 0 ? (int) round (vecPos[x].v) : 1;
+      NodeContainer cellDevices;
+      cellDevices.Create (devToPos);
+      devPosit += devToPos;
+      MobilityHelper cellMobility;
+      cellMobility.SetPositionAllocator (
           "ns3::RandomRectanglePositionAllocator", "X",
           PointerValue (CreateObjectWithAttributes<UniformRandomVariable> (
-              "Min", DoubleValue (vecPos[x].w * posFactor), "Max",
-              DoubleValue (vecPos[x].w * posFactor + posFactor))),
+              "Min", DoubleValue (vecPos[x].w * side), "Max",
+              DoubleValue (vecPos[x].w * side + side))),
           "Y",
           PointerValue (CreateObjectWithAttributes<UniformRandomVariable> (
-              "Min", DoubleValue (vecPos[x].h * posFactor), "Max",
-              DoubleValue (vecPos[x].h * posFactor + posFactor))));
-      tmpMobility[x].SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-      tmpMobility[x].Install (tmpDevices[x]);
-      devicesContainer.Add (tmpDevices[x]);
+              "Min", DoubleValue (vecPos[x].h * side), "Max",
+              DoubleValue (vecPos[x].h * side + side))));
+      cellMobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+      cellMobility.Install (cellDevices);
+      devicesContainer.Add (cellDevices);
     }
   //  //Put the devices in the respective cells
   //  NodeContainer tmpDevices[ppW][ppH];
@@ -262,7 +240,7 @@ main (int argc, char *argv[])
       std::ofstream normalizedFile;
       normalizedFile.open (cN);
 
-      int i;
+      uint32_t i;
       for (i = 0; i < ppH - 1; i++)
         {
           trafficFile << i << " ";
@@ -271,16 +249,16 @@ main (int argc, char *argv[])
       trafficFile << i << "\n";
       normalizedFile << i << "\n";
 
-      int j;
-      for (i = 0; i < ppH; i++)
+      uint32_t j;
+      for (i = 0; i < ppW; i++)
         {
-          for (j = 0; j < ppW - 1; j++)
+          for (j = 0; j < ppH - 1; j++)
             {
-              trafficFile << p_wh[i][j] << " ";
-              normalizedFile << pGwh[i][j] << " ";
+              trafficFile << densityMap.Get (i, j) << " ";
+              normalizedFile << densityMap.GetField (i, j) << " ";
             }
-          trafficFile << p_wh[i][j] << "\n";
-          normalizedFile << pGwh[i][j] << "\n";
+          trafficFile << densityMap.Get (i, j) << "\n";
+          normalizedFile << densityMap.GetField (i, j) << "\n";
         }
       trafficFile.close ();
       normalizedFile.close ();
@@ -0,0 +1,232 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+/*
+ * Samples end device placements from the traffic density map of
+ * devices-density-oriented-distrib without creating ns-3 nodes: the map is
+ * computed (same model and parameters for the same seed) or mapped from a
+ * --densityMap file, and the devices are drawn by DeviceSampler in chunks
+ * shared by the worker threads and streamed out.
+ *
+ * The output is the usual "x y z" text file or, when its name ends with
+ * .pack, a placement pack holding the population under the name of that text
+ * file, ready for --placementPack:
+ *
+ * ./ns3.36-devices-density-sampler-debug --nDevices=1000000 --seed=1 --pixSideLen=10
+ */
+
+#include "device-sampler.h"
+#include "placement-pack.h"
+
+#include "ns3/command-line.h"
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("DevicesDensitySampler");
+
+/**
+ * Splits devices [first, first + count) among the threads.
+ * @param body: called as body(t, begin, end) by thread t on its share
+ */
+template <typename Body>
+void
+ForEachShare(uint64_t first, uint64_t count, uint32_t threads, Body body)
+{
+    std::vector<std::thread> pool;
+    for (uint32_t t = 1; t < threads; ++t)
+    {
+        pool.emplace_back(body, t, first + count * t / threads, first + count * (t + 1) / threads);
+    }
+    body(0, first, first + count / threads);
+    for (std::thread& t : pool)
+    {
+        t.join();
+    }
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t nDevices = 0;
+    int seed = 1;
+    double areaWidth = 10000;
+    double areaHeight = 10000;
+    double pixSideLen = 2000;
+    uint32_t threads = 0;
+    std::string densityMapFile = "";
+    std::string output = "";
+
+    CommandLine cmd;
+    cmd.AddValue("nDevices", "Number of end devices to sample", nDevices);
+    cmd.AddValue("seed", "Independent replications seed", seed);
+    cmd.AddValue("areaWidth", "Area width in meters", areaWidth);
+    cmd.AddValue("areaHeight", "Area height in meters", areaHeight);
+    cmd.AddValue("pixSideLen", "Side of the density map cells in meters", pixSideLen);
+    cmd.AddValue("threads", "Worker threads (0: one per core)", threads);
+    cmd.AddValue("densityMap",
+                 "Density map file written by an earlier run, used instead of computing it",
+                 densityMapFile);
+    cmd.AddValue("output",
+                 "Placement file, a placement pack when it ends with .pack. Default: "
+                 "endDevices_DMS_Placement_<seed>s+<nDevices>d.dat in the placement folder",
+                 output);
+    cmd.Parse(argc, argv);
+
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    DensityMap densityMap;
+    if (!densityMapFile.empty())
+    {
+        if (!densityMap.Open(densityMapFile))
+        {
+            NS_FATAL_ERROR("Could not open the density map " << densityMapFile);
+        }
+    }
+    else
+    {
+        // Same parameter draws as devices-density-oriented-distrib, hence the same map
+        RngSeedManager::SetSeed(seed);
+        double wMax = 0.012673;
+        std::vector<double> angFreq_i(10);
+        std::vector<double> angFreq_j(10);
+        std::vector<double> phase_phi(10);
+        std::vector<double> phase_psi(10);
+        Ptr<UniformRandomVariable> rd = CreateObject<UniformRandomVariable>();
+        rd->SetAttribute("Min", DoubleValue(0.0));
+        rd->SetAttribute("Max", DoubleValue(1.0));
+        for (int i = 0; i < 10; ++i)
+        {
+            angFreq_i[i] = wMax * rd->GetValue();
+            angFreq_j[i] = wMax * rd->GetValue();
+            phase_phi[i] = 2 * M_PI * rd->GetValue();
+            phase_psi[i] = 2 * M_PI * rd->GetValue();
+        }
+        double mu = 17.7956;
+        double sigma = 2.1188;
+        densityMap.Allocate(uint32_t(floor(areaWidth / pixSideLen)),
+                            uint32_t(floor(areaHeight / pixSideLen)),
+                            pixSideLen,
+                            "");
+        densityMap.Compute(angFreq_i, angFreq_j, phase_phi, phase_psi, mu, sigma, threads);
+    }
+    if (uint64_t(densityMap.GetWidth()) * densityMap.GetHeight() > UINT32_MAX)
+    {
+        NS_FATAL_ERROR("The density map has more than 2^32 cells");
+    }
+    DeviceSampler sampler(densityMap);
+
+    std::string path = "/home/rogerio/git/sim-res/datafile/devices/placement/";
+    std::string name = "endDevices_DMS_Placement_" + std::to_string(seed) + "s+" +
+                       std::to_string(nDevices) + "d.dat";
+    if (output.empty())
+    {
+        output = path + name;
+    }
+    bool pack = output.size() > 5 && output.compare(output.size() - 5, 5, ".pack") == 0;
+    std::FILE* out = std::fopen(output.c_str(), "wb");
+    if (out == nullptr)
+    {
+        NS_FATAL_ERROR("Could not create " << output);
+    }
+
+    // One placement pack entry, written after the positions
+    struct
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entries;
+        uint32_t reserved;
+        uint64_t indexOffset;
+        uint64_t reserved2;
+    } header = {PlacementPack::MAGIC, PlacementPack::VERSION, 1, 0, 0, 0};
+    if (pack)
+    {
+        std::fwrite(&header, sizeof(header), 1, out);
+    }
+
+    const uint64_t chunk = 1 << 18;
+    std::vector<double> xyz(3 * chunk);
+    std::vector<std::string> text(threads);
+    for (uint64_t first = 0; first < nDevices; first += chunk)
+    {
+        uint64_t count = std::min(chunk, nDevices - first);
+        if (pack)
+        {
+            ForEachShare(first, count, threads, [&](uint32_t, uint64_t begin, uint64_t end) {
+                for (uint64_t i = begin; i < end; ++i)
+                {
+                    sampler.Sample(seed, i, &xyz[3 * (i - first)]);
+                }
+            });
+            std::fwrite(xyz.data(), sizeof(double), 3 * count, out);
+        }
+        else
+        {
+            ForEachShare(first, count, threads, [&](uint32_t t, uint64_t begin, uint64_t end) {
+                std::string& lines = text[t];
+                lines.clear();
+                char line[96];
+                double p[3];
+                for (uint64_t i = begin; i < end; ++i)
+                {
+                    sampler.Sample(seed, i, p);
+                    int n = std::snprintf(line, sizeof(line), "%g %g %g\n", p[0], p[1], p[2]);
+                    lines.append(line, n);
+                }
+            });
+            for (const std::string& lines : text)
+            {
+                std::fwrite(lines.data(), 1, lines.size(), out);
+            }
+        }
+    }
+
+    if (pack)
+    {
+        char entry[PlacementPack::NAME_SIZE + 16] = {};
+        name.copy(entry, PlacementPack::NAME_SIZE - 1);
+        uint64_t offset = sizeof(header);
+        std::memcpy(entry + PlacementPack::NAME_SIZE, &offset, sizeof(offset));
+        std::memcpy(entry + PlacementPack::NAME_SIZE + 8, &nDevices, sizeof(nDevices));
+        header.indexOffset = sizeof(header) + 24 * uint64_t(nDevices);
+        std::fwrite(entry, sizeof(entry), 1, out);
+        std::rewind(out);
+        std::fwrite(&header, sizeof(header), 1, out);
+    }
+    if (std::fclose(out) != 0)
+    {
+        NS_FATAL_ERROR("Could not write " << output);
+    }
+    std::cout << nDevices << " devices written to " << output << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef FORK_SERVER_H
+#define FORK_SERVER_H
+
+#include "ns3/fatal-error.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Runs the replications of an experiment in forked children of a process
+ * that has already built the shared part of the scenario.
+ *
+ * Serve () is called once, before Simulator::Run (). It returns in every
+ * child with the index of its replication, and the child goes on applying
+ * its own settings, simulating and writing its outputs as a standalone run
+ * would. The parent returns PARENT once all children have exited, with the
+ * result each child sent through Reply (). Children share the memory of the
+ * scenario copy-on-write and at most the given number run at a time.
+ */
+class ForkServer
+{
+  public:
+    static constexpr int32_t PARENT = -1;
+
+    /**
+     * @param jobs: children running at a time, 0 for the number of CPUs
+     */
+    explicit ForkServer(uint32_t jobs)
+        : m_jobs(jobs > 0 ? jobs : std::max(1u, std::thread::hardware_concurrency()))
+    {
+    }
+
+    /**
+     * Forks one child per replication.
+     * @return the replication index in a child, PARENT in the parent
+     */
+    int32_t Serve(uint32_t replications)
+    {
+        // Buffered output would otherwise be written again by every child
+        std::cout.flush();
+        std::fflush(nullptr);
+        m_results.assign(replications, "");
+        m_status.assign(replications, -1);
+        std::vector<Child> running;
+        uint32_t next = 0;
+        while (next < replications || !running.empty())
+        {
+            while (next < replications && running.size() < m_jobs)
+            {
+                int fds[2];
+                if (pipe(fds) < 0)
+                {
+                    NS_FATAL_ERROR("Could not create the result pipe of replication " << next);
+                }
+                pid_t pid = fork();
+                if (pid < 0)
+                {
+                    NS_FATAL_ERROR("Could not fork replication " << next);
+                }
+                if (pid == 0)
+                {
+                    close(fds[0]);
+                    for (const Child& child : running)
+                    {
+                        close(child.fd);
+                    }
+                    m_replyFd = fds[1];
+                    return next;
+                }
+                close(fds[1]);
+                running.push_back(Child{pid, fds[0], next});
+                next++;
+            }
+            Collect(running);
+        }
+        return PARENT;
+    }
+
+    bool IsChild() const
+    {
+        return m_replyFd >= 0;
+    }
+
+    /**
+     * Sends the result of this replication to the parent. Only in a child.
+     */
+    void Reply(const std::string& result)
+    {
+        size_t sent = 0;
+        while (m_replyFd >= 0 && sent < result.size())
+        {
+            ssize_t n = write(m_replyFd, result.data() + sent, result.size() - sent);
+            if (n < 0 && errno != EINTR)
+            {
+                break;
+            }
+            sent += n > 0 ? n : 0;
+        }
+    }
+
+    /**
+     * @return what the child of a replication sent through Reply ()
+     */
+    const std::string& GetResult(uint32_t replication) const
+    {
+        return m_results[replication];
+    }
+
+    /**
+     * @return exit status of the child of a replication, -1 when it did not exit normally
+     */
+    int GetStatus(uint32_t replication) const
+    {
+        return m_status[replication];
+    }
+
+    /**
+     * @return the numbers of a comma-separated list, e.g. "10,20,30"
+     */
+    static std::vector<uint32_t> ParseList(const std::string& list)
+    {
+        std::vector<uint32_t> values;
+        std::istringstream in(list);
+        std::string item;
+        while (std::getline(in, item, ','))
+        {
+            if (!item.empty())
+            {
+                values.push_back(std::stoul(item));
+            }
+        }
+        return values;
+    }
+
+  private:
+    struct Child
+    {
+        pid_t pid;
+        int fd;
+        uint32_t replication;
+    };
+
+    /**
+     * Reads the output of the running children and reaps those that closed their pipe.
+     */
+    void Collect(std::vector<Child>& running)
+    {
+        std::vector<pollfd> fds;
+        for (const Child& child : running)
+        {
+            fds.push_back(pollfd{child.fd, POLLIN, 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            return; // interrupted, poll again
+        }
+        for (size_t i = running.size(); i-- > 0;)
+        {
+            if (fds[i].revents == 0)
+            {
+                continue;
+            }
+            char buffer[4096];
+            ssize_t n = read(running[i].fd, buffer, sizeof(buffer));
+            if (n > 0)
+            {
+                m_results[running[i].replication].append(buffer, n);
+            }
+            else if (n == 0 || errno != EINTR)
+            {
+                close(running[i].fd);
+                int status;
+                waitpid(running[i].pid, &status, 0);
+                m_status[running[i].replication] = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+                running.erase(running.begin() + i);
+            }
+        }
+    }
+
+    uint32_t m_jobs;
+    int m_replyFd = -1;
+    std::vector<std::string> m_results;
+    std::vector<int> m_status;
+};
+
+} // namespace ns3
+
+#endif /* FORK_SERVER_H */
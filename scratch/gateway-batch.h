@@ -0,0 +1,225 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef GATEWAY_BATCH_H
+#define GATEWAY_BATCH_H
+
+#include "packet-status-tracker.h"
+#include "placement-pack.h"
+
+#include "ns3/application-container.h"
+#include "ns3/fatal-error.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/node-container.h"
+#include "ns3/periodic-sender.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Candidate gateway sets scored one after the other against the same end
+ * devices, in consecutive windows of a single simulation.
+ *
+ * As many gateways as the largest candidate are created once. For each
+ * candidate the gateways are moved to its positions (the ones it does not
+ * use are parked out of reach of every device), the tracker is cleared, the
+ * device applications are restarted and the window is simulated. The row of
+ * a candidate only counts the outcomes of the gateways it uses.
+ */
+class GatewayBatch
+{
+  public:
+    /**
+     * Loads the candidate sets.
+     * @param files: comma-separated gateway placement files, one per candidate
+     * @param pack: placement pack tried before the files
+     */
+    void Load(const std::string& files, const PlacementPack& pack)
+    {
+        std::istringstream in(files);
+        std::string file;
+        while (std::getline(in, file, ','))
+        {
+            if (file.empty())
+            {
+                continue;
+            }
+            Ptr<ListPositionAllocator> allocator = pack.Load(file);
+            if (allocator->GetSize() == 0)
+            {
+                NS_FATAL_ERROR("Could not read the gateway candidate " << file);
+            }
+            std::vector<Vector> positions;
+            for (uint32_t i = 0; i < allocator->GetSize(); ++i)
+            {
+                positions.push_back(allocator->GetNext());
+            }
+            m_files.push_back(file);
+            m_sets.push_back(positions);
+        }
+    }
+
+    uint32_t GetSize() const
+    {
+        return m_sets.size();
+    }
+
+    uint32_t GetMaxGateways() const
+    {
+        size_t max = 0;
+        for (const std::vector<Vector>& set : m_sets)
+        {
+            max = std::max(max, set.size());
+        }
+        return max;
+    }
+
+    /**
+     * Creates GetMaxGateways () parked gateway nodes with constant positions.
+     */
+    void Create(NodeContainer& gateways) const
+    {
+        gateways.Create(GetMaxGateways());
+        MobilityHelper mobility;
+        Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator>();
+        for (uint32_t i = 0; i < gateways.GetN(); ++i)
+        {
+            allocator->Add(Parked());
+        }
+        mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+        mobility.SetPositionAllocator(allocator);
+        mobility.Install(gateways);
+    }
+
+    /**
+     * Scores every candidate, writing one row per candidate.
+     * @param gateways: gateways made by Create (), with their LoRa stack installed
+     * @param apps: periodic senders of the end devices, started at 0 and stopped
+     * at duration for the first window
+     * @param tracker: packet tracker fed by the gateway outcome recorders, with
+     * the complete packets retired
+     * @param duration: traffic time of a window
+     * @param drain: time after the traffic for the last packets to complete
+     * @param prepare: called once the gateways of a candidate are in place,
+     * e.g. to assign the spreading factors again; may be empty
+     */
+    void Run(NodeContainer gateways,
+             ApplicationContainer apps,
+             PacketStatusTracker& tracker,
+             Time duration,
+             Time drain,
+             std::function<void()> prepare,
+             std::ostream& out) const
+    {
+        Ptr<UniformRandomVariable> initialDelay = CreateObject<UniformRandomVariable>();
+        out << "# candidate gateways sent received interfered noMoreReceivers "
+               "underSensitivity meanDelay"
+            << std::endl;
+        for (uint32_t c = 0; c < m_sets.size(); ++c)
+        {
+            const std::vector<Vector>& set = m_sets[c];
+            for (uint32_t g = 0; g < gateways.GetN(); ++g)
+            {
+                Vector position = g < set.size() ? set[g] : Parked();
+                gateways.Get(g)->GetObject<MobilityModel>()->SetPosition(position);
+            }
+            if (prepare)
+            {
+                prepare();
+            }
+            tracker.Clear();
+            if (c > 0)
+            {
+                // Same first-packet spread as a fresh PeriodicSenderHelper::Install
+                for (auto a = apps.Begin(); a != apps.End(); ++a)
+                {
+                    Ptr<PeriodicSender> sender = DynamicCast<PeriodicSender>(*a);
+                    double period = sender->GetInterval().GetSeconds();
+                    sender->SetInitialDelay(Seconds(initialDelay->GetValue(0, period)));
+                    sender->StartApplication();
+                }
+                Simulator::Schedule(duration, &GatewayBatch::StopApplications, apps);
+            }
+            Simulator::Stop(duration + drain);
+            Simulator::Run();
+            WriteRow(c, tracker, out);
+        }
+    }
+
+  private:
+    static void StopApplications(ApplicationContainer apps)
+    {
+        for (auto a = apps.Begin(); a != apps.End(); ++a)
+        {
+            DynamicCast<PeriodicSender>(*a)->StopApplication();
+        }
+    }
+
+    void WriteRow(uint32_t c, const PacketStatusTracker& tracker, std::ostream& out) const
+    {
+        uint64_t sent = tracker.GetSize(); // never reported by every gateway
+        uint64_t received = 0;
+        double delaySum = 0;
+        for (const DeviceAggregate& device : tracker.GetDeviceAggregates())
+        {
+            sent += device.retired;
+            received += device.received;
+            delaySum += device.delaySum;
+        }
+        uint64_t outcomes[_UNSET] = {};
+        for (uint32_t g = 0; g < m_sets[c].size(); ++g)
+        {
+            for (uint32_t o = 0; o < _UNSET; ++o)
+            {
+                outcomes[o] += tracker.GetGatewayAggregates()[g].outcomes[o];
+            }
+        }
+        out << m_files[c] << " " << m_sets[c].size() << " " << sent << " " << received << " "
+            << outcomes[_INTERFERED] << " " << outcomes[_NO_MORE_RECEIVERS] << " "
+            << outcomes[_UNDER_SENSITIVITY] << " " << (received > 0 ? delaySum / received : 0)
+            << std::endl;
+    }
+
+    /**
+     * @return position of the unused gateways, out of reach of every device
+     * of the 10 km areas of the experiments
+     */
+    static Vector Parked()
+    {
+        return Vector(1e7, 1e7, 0);
+    }
+
+    std::vector<std::string> m_files;
+    std::vector<std::vector<Vector>> m_sets;
+};
+
+} // namespace ns3
+
+#endif /* GATEWAY_BATCH_H */
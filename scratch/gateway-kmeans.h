@@ -0,0 +1,411 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef GATEWAY_KMEANS_H
+#define GATEWAY_KMEANS_H
+
+#include "ns3/random-variable-stream.h"
+#include "ns3/vector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * 2D k-d tree over a set of points (the gateway candidates), for nearest
+ * point queries in O(log k) instead of a scan of all k.
+ */
+class KdTree
+{
+  public:
+    /**
+     * Builds the tree; the points must outlive it.
+     */
+    void Build(const std::vector<Vector>& points)
+    {
+        m_points = &points;
+        m_index.resize(points.size());
+        std::iota(m_index.begin(), m_index.end(), 0);
+        Build(0, m_index.size(), 0);
+    }
+
+    /**
+     * @param dist2: set to the squared horizontal distance to the nearest point
+     * @return index of the point nearest to (x, y)
+     */
+    uint32_t Nearest(double x, double y, double& dist2) const
+    {
+        uint32_t best = 0;
+        dist2 = std::numeric_limits<double>::infinity();
+        Search(0, m_index.size(), 0, x, y, best, dist2);
+        return best;
+    }
+
+  private:
+    void Build(uint32_t lo, uint32_t hi, int axis)
+    {
+        if (hi - lo <= 1)
+        {
+            return;
+        }
+        uint32_t mid = lo + (hi - lo) / 2;
+        const std::vector<Vector>& p = *m_points;
+        std::nth_element(m_index.begin() + lo,
+                         m_index.begin() + mid,
+                         m_index.begin() + hi,
+                         [&](uint32_t a, uint32_t b) {
+                             return axis == 0 ? p[a].x < p[b].x : p[a].y < p[b].y;
+                         });
+        Build(lo, mid, 1 - axis);
+        Build(mid + 1, hi, 1 - axis);
+    }
+
+    void Search(uint32_t lo,
+                uint32_t hi,
+                int axis,
+                double x,
+                double y,
+                uint32_t& best,
+                double& bestDist2) const
+    {
+        if (lo >= hi)
+        {
+            return;
+        }
+        uint32_t mid = lo + (hi - lo) / 2;
+        const Vector& p = (*m_points)[m_index[mid]];
+        double d2 = (x - p.x) * (x - p.x) + (y - p.y) * (y - p.y);
+        if (d2 < bestDist2 || (d2 == bestDist2 && m_index[mid] < best))
+        {
+            best = m_index[mid];
+            bestDist2 = d2;
+        }
+        double diff = axis == 0 ? x - p.x : y - p.y;
+        if (diff < 0)
+        {
+            Search(lo, mid, 1 - axis, x, y, best, bestDist2);
+            if (diff * diff <= bestDist2)
+            {
+                Search(mid + 1, hi, 1 - axis, x, y, best, bestDist2);
+            }
+        }
+        else
+        {
+            Search(mid + 1, hi, 1 - axis, x, y, best, bestDist2);
+            if (diff * diff <= bestDist2)
+            {
+                Search(lo, mid, 1 - axis, x, y, best, bestDist2);
+            }
+        }
+    }
+
+    const std::vector<Vector>* m_points = nullptr;
+    std::vector<uint32_t> m_index; //!< points in tree order, each range split at its middle
+};
+
+/**
+ * Clustering-based gateway placement: k-means over the horizontal positions
+ * of the end devices, one gateway at each centroid.
+ *
+ * The centroids are seeded by k-means++ (each new one drawn with probability
+ * proportional to the squared distance to the nearest one already chosen)
+ * and refined by Lloyd iterations. Every assignment step puts the centroids
+ * in a k-d tree and splits the devices among threads in fixed blocks, whose
+ * partial sums are merged in block order, so the result only depends on the
+ * seed. An emptied cluster is moved to the device farthest from its centroid.
+ *
+ * With a coverage radius, gateways are added (facility-location style) while
+ * some device is out of reach: a new centroid at the farthest uncovered
+ * device, then Lloyd again.
+ */
+class GatewayKMeans
+{
+  public:
+    /**
+     * @param devices: end device positions
+     * @param threads: threads of the assignment steps
+     */
+    GatewayKMeans(const std::vector<Vector>& devices, uint32_t threads)
+        : m_devices(devices),
+          m_threads(std::max(1u, threads)),
+          m_assignment(devices.size()),
+          m_dist2(devices.size())
+    {
+    }
+
+    /**
+     * Seeds k centroids with k-means++.
+     */
+    void Seed(uint32_t k, Ptr<UniformRandomVariable> rng)
+    {
+        m_centroids.clear();
+        if (m_devices.empty() || k == 0)
+        {
+            return;
+        }
+        uint32_t first = std::min<uint32_t>(rng->GetValue(0, m_devices.size()),
+                                            m_devices.size() - 1);
+        m_centroids.push_back(Horizontal(m_devices[first]));
+        std::fill(m_dist2.begin(), m_dist2.end(), std::numeric_limits<double>::infinity());
+        while (m_centroids.size() < std::min<uint64_t>(k, m_devices.size()))
+        {
+            const Vector& last = m_centroids.back();
+            ForEachBlock([&](uint32_t, uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i)
+                {
+                    m_dist2[i] = std::min(m_dist2[i], Distance2(m_devices[i], last));
+                }
+            });
+            double total = std::accumulate(m_dist2.begin(), m_dist2.end(), 0.0);
+            if (total == 0)
+            {
+                break; // fewer distinct positions than centroids
+            }
+            double target = rng->GetValue(0, total);
+            uint32_t chosen = 0;
+            for (double sum = m_dist2[0]; sum <= target && chosen + 1 < m_devices.size();)
+            {
+                sum += m_dist2[++chosen];
+            }
+            m_centroids.push_back(Horizontal(m_devices[chosen]));
+        }
+    }
+
+    /**
+     * Lloyd iterations until no device changes cluster.
+     * @return iterations run
+     */
+    uint32_t Refine(uint32_t maxIterations)
+    {
+        if (m_centroids.empty())
+        {
+            return 0;
+        }
+        uint32_t iteration = 0;
+        while (Assign(iteration == 0) > 0 && ++iteration <= maxIterations)
+        {
+            Update();
+        }
+        return iteration;
+    }
+
+    /**
+     * Adds centroids while some device is farther than radius (3D, from a
+     * gateway at the given height) from the nearest one. Stops without
+     * covering every device when some device is more than radius below or
+     * above the gateways, or when there is a centroid per distinct device
+     * position, as the farthest distance can no longer shrink.
+     * @param added: set to the number of centroids added
+     * @return true when every device is covered
+     */
+    bool Cover(double radius, double height, uint32_t maxIterations, uint32_t& added)
+    {
+        added = 0;
+        for (const Vector& device : m_devices)
+        {
+            if (std::abs(height - device.z) > radius)
+            {
+                return false;
+            }
+        }
+        uint32_t distinct = CountDistinctPositions();
+        while (!m_centroids.empty())
+        {
+            uint32_t farthest = 0;
+            double farthestDist2 = -1;
+            for (uint32_t i = 0; i < m_devices.size(); ++i)
+            {
+                double dz = height - m_devices[i].z;
+                double d2 = m_dist2[i] + dz * dz;
+                if (d2 > farthestDist2)
+                {
+                    farthest = i;
+                    farthestDist2 = d2;
+                }
+            }
+            if (farthestDist2 <= radius * radius)
+            {
+                return true;
+            }
+            if (m_centroids.size() >= distinct)
+            {
+                return false;
+            }
+            m_centroids.push_back(Horizontal(m_devices[farthest]));
+            ++added;
+            Refine(maxIterations);
+        }
+        return m_devices.empty();
+    }
+
+    /**
+     * @return the centroids, z = 0
+     */
+    const std::vector<Vector>& GetCentroids() const
+    {
+        return m_centroids;
+    }
+
+    /**
+     * @return the sum of the squared horizontal distances of the devices to
+     * their centroids
+     */
+    double GetInertia() const
+    {
+        return std::accumulate(m_dist2.begin(), m_dist2.end(), 0.0);
+    }
+
+  private:
+    static constexpr uint32_t BLOCK = 4096;
+
+    static Vector Horizontal(const Vector& v)
+    {
+        return Vector(v.x, v.y, 0);
+    }
+
+    static double Distance2(const Vector& a, const Vector& b)
+    {
+        return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
+    }
+
+    uint32_t CountDistinctPositions() const
+    {
+        std::vector<std::pair<double, double>> positions;
+        positions.reserve(m_devices.size());
+        for (const Vector& device : m_devices)
+        {
+            positions.emplace_back(device.x, device.y);
+        }
+        std::sort(positions.begin(), positions.end());
+        return std::unique(positions.begin(), positions.end()) - positions.begin();
+    }
+
+    /**
+     * Runs body(block, begin, end) over the device blocks, on m_threads threads.
+     */
+    void ForEachBlock(const std::function<void(uint32_t, uint32_t, uint32_t)>& body) const
+    {
+        uint32_t blocks = (m_devices.size() + BLOCK - 1) / BLOCK;
+        std::atomic<uint32_t> next(0);
+        auto worker = [&]() {
+            for (uint32_t b = next++; b < blocks; b = next++)
+            {
+                body(b, b * BLOCK, std::min<uint32_t>(m_devices.size(), (b + 1) * BLOCK));
+            }
+        };
+        std::vector<std::thread> pool;
+        for (uint32_t t = 1; t < std::min(m_threads, blocks); ++t)
+        {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& t : pool)
+        {
+            t.join();
+        }
+    }
+
+    /**
+     * Moves each device to its nearest centroid and accumulates the per block
+     * sums of the clusters.
+     * @return number of devices that changed cluster
+     */
+    uint32_t Assign(bool first)
+    {
+        KdTree tree;
+        tree.Build(m_centroids);
+        uint32_t k = m_centroids.size();
+        uint32_t blocks = (m_devices.size() + BLOCK - 1) / BLOCK;
+        m_blockSums.assign(uint64_t(blocks) * k, Vector(0, 0, 0));
+        std::vector<uint32_t> blockChanges(blocks);
+        ForEachBlock([&](uint32_t b, uint32_t begin, uint32_t end) {
+            Vector* sums = m_blockSums.data() + uint64_t(b) * k;
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                uint32_t c = tree.Nearest(m_devices[i].x, m_devices[i].y, m_dist2[i]);
+                if (first || c != m_assignment[i])
+                {
+                    blockChanges[b]++;
+                }
+                m_assignment[i] = c;
+                sums[c].x += m_devices[i].x;
+                sums[c].y += m_devices[i].y;
+                sums[c].z += 1; // devices in the cluster
+            }
+        });
+        return std::accumulate(blockChanges.begin(), blockChanges.end(), 0u);
+    }
+
+    /**
+     * Moves each centroid to the mean of its cluster.
+     */
+    void Update()
+    {
+        uint32_t k = m_centroids.size();
+        uint32_t blocks = m_blockSums.size() / std::max(1u, k);
+        std::vector<Vector> sums(k, Vector(0, 0, 0));
+        for (uint32_t b = 0; b < blocks; ++b)
+        {
+            for (uint32_t c = 0; c < k; ++c)
+            {
+                const Vector& s = m_blockSums[uint64_t(b) * k + c];
+                sums[c].x += s.x;
+                sums[c].y += s.y;
+                sums[c].z += s.z;
+            }
+        }
+        for (uint32_t c = 0; c < k; ++c)
+        {
+            if (sums[c].z > 0)
+            {
+                m_centroids[c] = Vector(sums[c].x / sums[c].z, sums[c].y / sums[c].z, 0);
+            }
+            else
+            {
+                // Empty cluster: take over the worst served device
+                uint32_t farthest = std::max_element(m_dist2.begin(), m_dist2.end()) -
+                                    m_dist2.begin();
+                m_centroids[c] = Horizontal(m_devices[farthest]);
+                m_dist2[farthest] = 0;
+            }
+        }
+    }
+
+    const std::vector<Vector>& m_devices;
+    uint32_t m_threads;
+    std::vector<Vector> m_centroids;
+    std::vector<uint32_t> m_assignment;
+    std::vector<double> m_dist2;        //!< squared horizontal distance to the centroid
+    std::vector<Vector> m_blockSums;   //!< per block and cluster: sum of x, of y, devices
+};
+
+} // namespace ns3
+
+#endif /* GATEWAY_KMEANS_H */
@@ -0,0 +1,206 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef GATEWAY_OUTCOME_RECORDER_H
+#define GATEWAY_OUTCOME_RECORDER_H
+
+#include "packet-status-tracker.h"
+
+#include "ns3/callback.h"
+#include "ns3/gateway-lora-phy.h"
+#include "ns3/lora-net-device.h"
+#include "ns3/lora-tag.h"
+#include "ns3/node-container.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/simulator.h"
+
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Records the reception outcomes of one gateway into a PacketStatusTracker.
+ *
+ * One recorder is bound to the four outcome traces of each GatewayLoraPhy
+ * and carries the dense index of its gateway, so an outcome costs a single
+ * tracker lookup and no packet tag is read: the SF is captured once, at
+ * transmission, by RecordTransmission ().
+ */
+class GatewayOutcomeRecorder : public SimpleRefCount<GatewayOutcomeRecorder>
+{
+  public:
+    /**
+     * Called with the tracker slot of a packet
+     */
+    typedef Callback<void, uint32_t> SlotCallback;
+
+    /**
+     * @param tracker: tracker of the transmitted packets
+     * @param index: dense gateway index, in [0, tracker.GetGateways ())
+     * @param systemId: node id of the gateway, stored as receiver id
+     */
+    GatewayOutcomeRecorder(PacketStatusTracker& tracker, uint32_t index, uint32_t systemId)
+        : m_tracker(tracker),
+          m_index(index),
+          m_systemId(systemId)
+    {
+    }
+
+    /**
+     * @param cb: called when a packet is received for the first time, by any gateway
+     */
+    void SetFirstReceptionCallback(SlotCallback cb)
+    {
+        m_firstReception = cb;
+    }
+
+    /**
+     * @param cb: called when every gateway has an outcome for a packet; the
+     * recorder no longer uses the slot afterwards, so the callback may retire it
+     */
+    void SetCompleteCallback(SlotCallback cb)
+    {
+        m_complete = cb;
+    }
+
+    void Connect(Ptr<lorawan::GatewayLoraPhy> phy)
+    {
+        phy->TraceConnectWithoutContext(
+            "ReceivedPacket",
+            MakeCallback(&GatewayOutcomeRecorder::Received, this));
+        phy->TraceConnectWithoutContext(
+            "LostPacketBecauseInterference",
+            MakeCallback(&GatewayOutcomeRecorder::Interfered, this));
+        phy->TraceConnectWithoutContext(
+            "LostPacketBecauseNoMoreReceivers",
+            MakeCallback(&GatewayOutcomeRecorder::NoMoreReceivers, this));
+        phy->TraceConnectWithoutContext(
+            "LostPacketBecauseUnderSensitivity",
+            MakeCallback(&GatewayOutcomeRecorder::UnderSensitivity, this));
+    }
+
+    /**
+     * Sizes the tracker to the gateways and connects one recorder per
+     * gateway, indexed in container order.
+     * @return the recorders, to be kept alive while the simulation runs
+     */
+    static std::vector<Ptr<GatewayOutcomeRecorder>> Install(
+        const NodeContainer& gateways,
+        PacketStatusTracker& tracker,
+        SlotCallback firstReception,
+        SlotCallback complete)
+    {
+        tracker.SetGateways(gateways.GetN());
+        std::vector<Ptr<GatewayOutcomeRecorder>> recorders;
+        for (uint32_t i = 0; i < gateways.GetN(); ++i)
+        {
+            Ptr<Node> gateway = gateways.Get(i);
+            Ptr<GatewayOutcomeRecorder> recorder =
+                Create<GatewayOutcomeRecorder>(tracker, i, gateway->GetId());
+            recorder->SetFirstReceptionCallback(firstReception);
+            recorder->SetCompleteCallback(complete);
+            Ptr<lorawan::LoraNetDevice> loraNetDevice =
+                gateway->GetDevice(0)->GetObject<lorawan::LoraNetDevice>();
+            recorder->Connect(loraNetDevice->GetPhy()->GetObject<lorawan::GatewayLoraPhy>());
+            recorders.push_back(recorder);
+        }
+        return recorders;
+    }
+
+    /**
+     * Creates the record of a transmitted packet, with its sender, size,
+     * sent time and SF.
+     * @return slot of the record
+     */
+    static uint32_t RecordTransmission(PacketStatusTracker& tracker,
+                                       Ptr<const Packet> packet,
+                                       uint32_t systemId)
+    {
+        lorawan::LoraTag tag;
+        packet->PeekPacketTag(tag);
+        uint32_t slot = tracker.Insert(packet->GetUid());
+        PacketRecord& status = tracker.Get(slot);
+        status.senderId = systemId;
+        status.size = packet->GetSize();
+        status.sentTime = Simulator::Now();
+        status.senderSF = tag.GetSpreadingFactor();
+        return slot;
+    }
+
+  private:
+    void Received(Ptr<const Packet> packet, uint32_t)
+    {
+        Record(packet, _RECEIVED);
+    }
+
+    void Interfered(Ptr<const Packet> packet, uint32_t)
+    {
+        Record(packet, _INTERFERED);
+    }
+
+    void NoMoreReceivers(Ptr<const Packet> packet, uint32_t)
+    {
+        Record(packet, _NO_MORE_RECEIVERS);
+    }
+
+    void UnderSensitivity(Ptr<const Packet> packet, uint32_t)
+    {
+        Record(packet, _UNDER_SENSITIVITY);
+    }
+
+    void Record(Ptr<const Packet> packet, PacketOutcome outcome)
+    {
+        uint32_t slot = m_tracker.Find(packet->GetUid());
+        if (slot == PacketStatusTracker::NOT_FOUND)
+        {
+            return;
+        }
+        uint32_t outcomes = m_tracker.SetOutcome(slot, m_index, outcome);
+        if (outcome == _RECEIVED)
+        {
+            PacketRecord& status = m_tracker.Get(slot);
+            if (status.receivedTime.IsZero())
+            {
+                status.receivedTime = Simulator::Now();
+                status.receiverId = m_systemId;
+                status.receiverSF = status.senderSF;
+                if (!m_firstReception.IsNull())
+                {
+                    m_firstReception(slot);
+                }
+            }
+        }
+        if (outcomes == m_tracker.GetGateways() && !m_complete.IsNull())
+        {
+            m_complete(slot);
+        }
+    }
+
+    PacketStatusTracker& m_tracker;
+    uint32_t m_index;
+    uint32_t m_systemId;
+    SlotCallback m_firstReception;
+    SlotCallback m_complete;
+};
+
+} // namespace ns3
+
+#endif /* GATEWAY_OUTCOME_RECORDER_H */
@@ -0,0 +1,164 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+/*
+ * Clustering-based gateway placement: k-means++ seeding and Lloyd iterations
+ * over the end device positions (GatewayKMeans), one gateway at 30 m over
+ * each centroid, written in the "x y z" format read by GatewaysPlacement ().
+ *
+ * With --coverage, gateways are added until every device is within the SF12
+ * range given by the link budget of the experiments (log-distance loss,
+ * exponent 3.76 and 10 dB at 1 m, 14 dBm devices, -142.5 dBm SF12 gateway
+ * sensitivity):
+ *
+ * ./ns3.36-gateways-kmeans-distrib-debug --nDevices=100000 --nGateways=50 --seed=1 --coverage=true
+ */
+
+#include "gateway-kmeans.h"
+#include "placement-pack.h"
+
+#include "ns3/command-line.h"
+#include "ns3/core-module.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("GatewaysKMeansPlacement");
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t nDevices = 0;
+    uint32_t nGateways = 1;
+    int seed = 1;
+    uint32_t threads = 0;
+    uint32_t maxIterations = 100;
+    bool coverage = false;
+    double txPower = 14;
+    double sensitivity = -142.5;
+    double pathLossExponent = 3.76;
+    double referenceLoss = 10;
+    double margin = 0;
+    std::string devicesFile = "";
+    std::string placementPackFile = "";
+    std::string output = "";
+
+    CommandLine cmd;
+    cmd.AddValue("nDevices", "Number of end devices", nDevices);
+    cmd.AddValue("nGateways", "Number of gateways (clusters)", nGateways);
+    cmd.AddValue("seed", "Independent replications seed", seed);
+    cmd.AddValue("threads", "Threads of the assignment steps (0: one per core)", threads);
+    cmd.AddValue("maxIterations", "Maximum Lloyd iterations", maxIterations);
+    cmd.AddValue("coverage", "Add gateways until every device is within SF12 range", coverage);
+    cmd.AddValue("txPower", "End device transmission power in dBm", txPower);
+    cmd.AddValue("sensitivity", "Gateway SF12 sensitivity in dBm", sensitivity);
+    cmd.AddValue("pathLossExponent", "Log-distance path loss exponent", pathLossExponent);
+    cmd.AddValue("referenceLoss", "Log-distance loss at 1 m in dB", referenceLoss);
+    cmd.AddValue("margin", "Link margin kept below the SF12 budget in dB", margin);
+    cmd.AddValue("devicesFile",
+                 "End devices placement file. Default: the LNM placement of the seed",
+                 devicesFile);
+    cmd.AddValue("placementPack",
+                 "Placement pack read instead of the placement files it holds",
+                 placementPackFile);
+    cmd.AddValue("output",
+                 "Gateway placement file. Default: "
+                 "kmeansPlacement_<seed>s+<nDevices>d+<nGateways>g.dat in the placement folder",
+                 output);
+    cmd.Parse(argc, argv);
+
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    RngSeedManager::SetSeed(seed);
+
+    PlacementPack placementPack;
+    if (!placementPackFile.empty() && !placementPack.Open(placementPackFile))
+    {
+        NS_FATAL_ERROR("Could not open the placement pack " << placementPackFile);
+    }
+    if (devicesFile.empty())
+    {
+        devicesFile =
+            "/home/rogerio/git/sim-res/datafile/devices/placement/endDevices_LNM_Placement_" +
+            std::to_string(seed) + "s+" + std::to_string(nDevices) + "d.dat";
+    }
+    Ptr<ListPositionAllocator> allocator = placementPack.Load(devicesFile);
+    if (allocator->GetSize() == 0)
+    {
+        NS_FATAL_ERROR("Could not open the file - '" << devicesFile << "'");
+    }
+    std::vector<Vector> devices;
+    devices.reserve(allocator->GetSize());
+    for (uint32_t i = 0; i < allocator->GetSize(); ++i)
+    {
+        devices.push_back(allocator->GetNext());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    double gatewayAltitude = 30.0;
+    GatewayKMeans kmeans(devices, threads);
+    kmeans.Seed(nGateways, CreateObject<UniformRandomVariable>());
+    uint32_t iterations = kmeans.Refine(maxIterations);
+    uint32_t added = 0;
+    if (coverage)
+    {
+        // Largest distance at which the SF12 budget closes
+        double budget = txPower - sensitivity - margin - referenceLoss;
+        double radius = std::pow(10, budget / (10 * pathLossExponent));
+        bool covered = kmeans.Cover(radius, gatewayAltitude, maxIterations, added);
+        std::cout << "SF12 range " << radius << " m, " << added << " gateways added" << std::endl;
+        if (!covered)
+        {
+            std::cout << "Coverage unreachable: some devices stay out of SF12 range" << std::endl;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (output.empty())
+    {
+        output = "/home/rogerio/git/sim-res/datafile/kmeans/placement/kmeansPlacement_" +
+                 std::to_string(seed) + "s+" + std::to_string(nDevices) + "d+" +
+                 std::to_string(nGateways) + "g.dat";
+    }
+    std::ofstream gatewaysFile(output);
+    if (!gatewaysFile)
+    {
+        NS_FATAL_ERROR("Could not create " << output);
+    }
+    for (const Vector& c : kmeans.GetCentroids())
+    {
+        gatewaysFile << c.x << " " << c.y << " " << gatewayAltitude << std::endl;
+    }
+    gatewaysFile.close();
+
+    std::cout << kmeans.GetCentroids().size() << " gateways for " << devices.size()
+              << " devices, " << iterations << " iterations, RMS distance "
+              << std::sqrt(kmeans.GetInertia() / devices.size()) << " m, " << elapsed.count()
+              << " s" << std::endl;
+
+    return 0;
+}
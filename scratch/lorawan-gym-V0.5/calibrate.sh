@@ -0,0 +1,17 @@
+#!/bin/sh
+# Compares the analytic reward (--fidelity=analytic) with the simulated one on
+# random UAV configurations and prints the mean absolute error of each seed.
+# Run from the ns-3 root directory:
+#   sh scratch/lorawan-gym-V0.5/calibrate.sh [nDevices] [steps] [servedProbability]
+
+ECHO="/bin/echo -e"
+DEVICES=${1:-10}
+STEPS=${2:-20}
+SERVED=${3:-0.5}
+
+$ECHO "seed mae"
+for SEED in 1 2 3 4 5 6 7 8 9 10; do
+  ./ns3 run "scratch/lorawan-gym-V0.5/sim --simSeed="$SEED" --nDevices="$DEVICES" --calibrate="$STEPS" --servedProbability="$SERVED"" |
+    awk -v seed="$SEED" '$1 == "calibration" && $2 ~ /^[0-9]+$/ { e = $3 - $4; mae += (e < 0 ? -e : e); n++ }
+      END { if (n > 0) printf "%d %.4f\n", seed, mae / n }'
+done
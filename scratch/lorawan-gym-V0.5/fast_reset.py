@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+In-process episode reset for the LoRaWAN environment.
+
+Ns3Env.reset() kills and relaunches sim.cc, which reloads the placement files and
+reinstalls the whole network. fast_reset() instead sends the reserved RESET_ACTION:
+sim.cc puts the UAVs back in their start positions, clears its trackers and reseeds
+the application start times, keeping the simulation process and its socket alive.
+"""
+
+__author__ = "Rogério S. Silva"
+__copyright__ = "Copyright (c) 2023, NumbERS - Federal Institute of Goiás, Inhumas - IFG"
+__version__ = "0.1.0"
+__email__ = "rogerio.sousa@ifg.edu.br"
+
+# Must match RESET_ACTION in sim.cc
+RESET_ACTION = 0xFFFFFFFF
+
+
+def reset_action(env):
+    """
+    :return: the action that restarts the episode, shaped for the env action space
+    """
+    space = env.action_space
+    if hasattr(space, "n"):  # Discrete
+        return RESET_ACTION
+    return [RESET_ACTION] * space.shape[0]  # Box (joint actions)
+
+
+def fast_reset(env):
+    """
+    Restarts the episode of a running Ns3Env.
+    :return: first observation of the new episode
+    """
+    env.ns3ZmqBridge.send_actions(reset_action(env))
+    env.ns3ZmqBridge.rx_env_state()
+    env.envDirty = False
+    return env.ns3ZmqBridge.get_obs()
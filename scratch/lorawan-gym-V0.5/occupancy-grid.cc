@@ -0,0 +1,152 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+
+#include "occupancy-grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ns3
+{
+
+OccupancyGrid::OccupancyGrid()
+    : m_step(1.0),
+      m_nX(0),
+      m_nY(0)
+{
+}
+
+void
+OccupancyGrid::SetLattice(const Box& bounds, const Vector& origin, double step)
+{
+    m_origin = origin;
+    m_step = step;
+    m_nX = uint32_t(std::floor((bounds.xMax - origin.x) / step)) + 1;
+    m_nY = uint32_t(std::floor((bounds.yMax - origin.y) / step)) + 1;
+    m_count.assign(size_t(m_nX) * m_nY, 0);
+    m_pending.assign(m_count.size(), 0);
+    m_owner.assign(m_count.size(), NO_OWNER);
+}
+
+uint32_t
+OccupancyGrid::GetCell(const Vector& position) const
+{
+    double i = std::round((position.x - m_origin.x) / m_step);
+    double j = std::round((position.y - m_origin.y) / m_step);
+    i = std::min(std::max(i, 0.0), double(m_nX - 1));
+    j = std::min(std::max(j, 0.0), double(m_nY - 1));
+    return uint32_t(j) * m_nX + uint32_t(i);
+}
+
+void
+OccupancyGrid::Add(const Vector& position)
+{
+    m_count[GetCell(position)] += 1;
+}
+
+void
+OccupancyGrid::Remove(const Vector& position)
+{
+    m_count[GetCell(position)] -= 1;
+}
+
+void
+OccupancyGrid::Clear()
+{
+    std::fill(m_count.begin(), m_count.end(), 0);
+}
+
+bool
+OccupancyGrid::IsFree(const Vector& position, uint32_t separation) const
+{
+    return CountAround(m_count, GetCell(position), separation) == 0;
+}
+
+uint32_t
+OccupancyGrid::ValidateMoves(const std::vector<Vector>& positions,
+                             std::vector<Vector>& targets,
+                             uint32_t separation)
+{
+    uint32_t n = positions.size();
+    std::vector<uint32_t> from(n);
+    std::vector<uint32_t> to(n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        from[i] = GetCell(positions[i]);
+        to[i] = GetCell(targets[i]);
+        m_pending[to[i]] += 1;
+        m_owner[from[i]] = i;
+    }
+
+    uint32_t cancelled = 0;
+    bool conflict = true;
+    while (conflict)
+    {
+        conflict = false;
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            if (to[i] == from[i])
+            {
+                continue;
+            }
+            uint32_t j = m_owner[to[i]];
+            bool swap = j != NO_OWNER && to[j] == from[i];
+            // The UAV itself is counted in its target cell
+            if (swap || CountAround(m_pending, to[i], separation) > 1)
+            {
+                m_pending[to[i]] -= 1;
+                m_pending[from[i]] += 1;
+                to[i] = from[i];
+                targets[i] = positions[i];
+                cancelled += 1;
+                conflict = true;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        m_pending[to[i]] = 0;
+        m_owner[from[i]] = NO_OWNER;
+    }
+    return cancelled;
+}
+
+uint32_t
+OccupancyGrid::CountAround(const std::vector<uint16_t>& counts,
+                           uint32_t cell,
+                           uint32_t separation) const
+{
+    int64_t x = cell % m_nX;
+    int64_t y = cell / m_nX;
+    int64_t r = separation;
+    uint32_t total = 0;
+    for (int64_t j = std::max<int64_t>(y - r, 0); j <= std::min<int64_t>(y + r, m_nY - 1); ++j)
+    {
+        for (int64_t i = std::max<int64_t>(x - r, 0); i <= std::min<int64_t>(x + r, m_nX - 1); ++i)
+        {
+            total += counts[j * m_nX + i];
+        }
+    }
+    return total;
+}
+
+} // namespace ns3
@@ -0,0 +1,101 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include "ns3/box.h"
+#include "ns3/vector.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * UAV counts per cell of the movement lattice, for constant-time collision
+ * and minimum separation checks.
+ *
+ * Positions are mapped to the nearest lattice cell, so UAVs on the lattice
+ * collide exactly when their positions are equal; UAVs placed off the
+ * lattice collide when their positions round to the same cell, whatever
+ * their distance.
+ */
+class OccupancyGrid
+{
+  public:
+    OccupancyGrid();
+
+    /**
+     * Sets the lattice (origin.x + i * step, origin.y + j * step) inside the
+     * bounds and empties the grid.
+     */
+    void SetLattice(const Box& bounds, const Vector& origin, double step);
+
+    uint32_t GetCell(const Vector& position) const;
+
+    void Add(const Vector& position);
+    void Remove(const Vector& position);
+    void Clear();
+
+    /**
+     * @param separation: minimum distance to the other UAVs, in cells
+     * (Chebyshev distance, 0 only forbids the same cell)
+     * @return true when no UAV is within the separation of the position
+     */
+    bool IsFree(const Vector& position, uint32_t separation) const;
+
+    /**
+     * Validates simultaneous movements against each other: a UAV cannot end
+     * the step within the separation of another UAV, and two UAVs cannot swap
+     * cells. Those UAVs stay in place, which can block other movements in
+     * turn, so the check repeats until no conflict remains. Every pass is
+     * linear in the number of UAVs.
+     * @param positions: current UAV positions
+     * @param targets: UAV positions after the movements, updated in place
+     * @return number of movements cancelled
+     */
+    uint32_t ValidateMoves(const std::vector<Vector>& positions,
+                           std::vector<Vector>& targets,
+                           uint32_t separation);
+
+  private:
+    static constexpr uint32_t NO_OWNER = UINT32_MAX;
+
+    /**
+     * @return number of UAVs in the cells within the separation of a cell
+     */
+    uint32_t CountAround(const std::vector<uint16_t>& counts,
+                         uint32_t cell,
+                         uint32_t separation) const;
+
+    Vector m_origin;
+    double m_step;
+    uint32_t m_nX;
+    uint32_t m_nY;
+    std::vector<uint16_t> m_count;   // UAVs in each cell
+    std::vector<uint16_t> m_pending; // targets in each cell, during ValidateMoves
+    std::vector<uint32_t> m_owner;   // a UAV in each cell, during ValidateMoves
+};
+
+} // namespace ns3
+
+#endif /* OCCUPANCY_GRID_H */
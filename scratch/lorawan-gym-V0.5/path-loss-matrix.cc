@@ -0,0 +1,99 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+
+#include "path-loss-matrix.h"
+
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/mobility-model.h"
+
+#include <cmath>
+
+namespace ns3
+{
+
+PathLossMatrix::PathLossMatrix()
+    : m_step(1.0),
+      m_txPower(0.0),
+      m_nX(0),
+      m_nY(0),
+      m_nDevices(0)
+{
+}
+
+void
+PathLossMatrix::Compute(Ptr<PropagationLossModel> loss,
+                        const NodeContainer& devices,
+                        const Box& bounds,
+                        const Vector& origin,
+                        double step,
+                        double txPower)
+{
+    m_step = step;
+    m_txPower = txPower;
+    m_origin = Vector(origin.x, origin.y, bounds.zMin);
+    m_nX = uint32_t(std::floor((bounds.xMax - m_origin.x) / step)) + 1;
+    m_nY = uint32_t(std::floor((bounds.yMax - m_origin.y) / step)) + 1;
+    m_nDevices = devices.GetN();
+    m_rxPower.resize(size_t(GetCells()) * m_nDevices);
+
+    std::vector<Ptr<MobilityModel>> deviceMobility;
+    deviceMobility.reserve(m_nDevices);
+    for (auto d = devices.Begin(); d != devices.End(); ++d)
+    {
+        deviceMobility.push_back((*d)->GetObject<MobilityModel>());
+    }
+    Ptr<ConstantPositionMobilityModel> cellMobility = CreateObject<ConstantPositionMobilityModel>();
+    for (uint32_t cell = 0; cell < GetCells(); ++cell)
+    {
+        cellMobility->SetPosition(GetCellPosition(cell));
+        float* column = &m_rxPower[size_t(cell) * m_nDevices];
+        for (uint32_t d = 0; d < m_nDevices; ++d)
+        {
+            column[d] = loss->CalcRxPower(txPower, deviceMobility[d], cellMobility);
+        }
+    }
+}
+
+uint32_t
+PathLossMatrix::GetCell(const Vector& position) const
+{
+    double i = std::round((position.x - m_origin.x) / m_step);
+    double j = std::round((position.y - m_origin.y) / m_step);
+    // Tolerate the rounding of positions built from sums of steps
+    if (i < 0 || j < 0 || i >= m_nX || j >= m_nY ||
+        std::abs(position.x - (m_origin.x + i * m_step)) > 1e-6 * m_step ||
+        std::abs(position.y - (m_origin.y + j * m_step)) > 1e-6 * m_step ||
+        std::abs(position.z - m_origin.z) > 1e-6)
+    {
+        return NOT_ON_GRID;
+    }
+    return uint32_t(j) * m_nX + uint32_t(i);
+}
+
+Vector
+PathLossMatrix::GetCellPosition(uint32_t cell) const
+{
+    return Vector(m_origin.x + (cell % m_nX) * m_step,
+                  m_origin.y + (cell / m_nX) * m_step,
+                  m_origin.z);
+}
+
+} // namespace ns3
@@ -0,0 +1,111 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef PATH_LOSS_MATRIX_H
+#define PATH_LOSS_MATRIX_H
+
+#include "ns3/box.h"
+#include "ns3/node-container.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/vector.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Received power from every end device to every cell of the UAV movement
+ * lattice (origin.x + i * step, origin.y + j * step, bounds.zMin) inside the
+ * bounds.
+ *
+ * The matrix is stored cell-major, so the powers of all devices to one cell
+ * are a contiguous column: placing a UAV on a cell selects a column instead of
+ * evaluating the loss model once per device. Only valid for deterministic
+ * loss models, such as the log-distance model of the gym.
+ */
+class PathLossMatrix
+{
+  public:
+    static constexpr uint32_t NOT_ON_GRID = UINT32_MAX;
+
+    PathLossMatrix();
+
+    /**
+     * Evaluates the loss model between the devices and every lattice cell.
+     * @param origin: position of the first lattice cell, the lowest x and y
+     * @param txPower: transmission power of the devices (dBm)
+     */
+    void Compute(Ptr<PropagationLossModel> loss,
+                 const NodeContainer& devices,
+                 const Box& bounds,
+                 const Vector& origin,
+                 double step,
+                 double txPower);
+
+    /**
+     * @return index of the cell at the position or NOT_ON_GRID
+     */
+    uint32_t GetCell(const Vector& position) const;
+
+    Vector GetCellPosition(uint32_t cell) const;
+
+    /**
+     * @return received power (dBm) of every device at the cell
+     */
+    const float* GetColumn(uint32_t cell) const
+    {
+        return &m_rxPower[size_t(cell) * m_nDevices];
+    }
+
+    float GetRxPower(uint32_t device, uint32_t cell) const
+    {
+        return m_rxPower[size_t(cell) * m_nDevices + device];
+    }
+
+    float GetPathLoss(uint32_t device, uint32_t cell) const
+    {
+        return m_txPower - GetRxPower(device, cell);
+    }
+
+    uint32_t GetCells() const
+    {
+        return m_nX * m_nY;
+    }
+
+    uint32_t GetDevices() const
+    {
+        return m_nDevices;
+    }
+
+  private:
+    Vector m_origin; // position of cell 0
+    double m_step;
+    double m_txPower;
+    uint32_t m_nX;
+    uint32_t m_nY;
+    uint32_t m_nDevices;
+    std::vector<float> m_rxPower; // [cell][device]
+};
+
+} // namespace ns3
+
+#endif /* PATH_LOSS_MATRIX_H */
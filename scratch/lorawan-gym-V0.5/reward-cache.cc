@@ -0,0 +1,173 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+
+#include "reward-cache.h"
+
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+namespace ns3
+{
+
+RewardCache::RewardCache()
+    : m_capacity(1024),
+      m_hits(0),
+      m_misses(0)
+{
+}
+
+RewardCache::~RewardCache()
+{
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+}
+
+void
+RewardCache::SetFile(std::string filename)
+{
+    m_disk.clear();
+    // Create the file when it does not exist, without truncating it otherwise
+    std::ofstream(filename, std::ios::app).close();
+    m_file.open(filename, std::ios::in | std::ios::out);
+    if (!m_file)
+    {
+        std::cout << "Could not open the file - '" << filename << "'" << std::endl;
+        return;
+    }
+    std::string line;
+    std::streamoff offset = 0;
+    while (std::getline(m_file, line))
+    {
+        std::string key = line.substr(0, line.find(' '));
+        // A later line of the same key (e.g. from a concurrent worker) wins
+        if (!key.empty() && key.size() < line.size())
+        {
+            m_disk[key] = offset;
+        }
+        offset += line.size() + 1;
+    }
+    m_file.clear();
+}
+
+void
+RewardCache::SetCapacity(uint32_t capacity)
+{
+    m_capacity = capacity;
+    while (m_lru.size() > m_capacity)
+    {
+        m_memory.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+}
+
+uint32_t
+RewardCache::GetCapacity() const
+{
+    return m_capacity;
+}
+
+bool
+RewardCache::Lookup(const std::string& key, RewardCacheEntry& entry)
+{
+    auto it = m_memory.find(key);
+    if (it != m_memory.end())
+    {
+        // Move to the front, the iterators stay valid
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        entry = it->second->second;
+        m_hits += 1;
+        return true;
+    }
+    auto disk = m_disk.find(key);
+    if (disk != m_disk.end())
+    {
+        std::string fileKey;
+        m_file.seekg(disk->second);
+        if (m_file >> fileKey >> entry.qos >> entry.numPackets >> entry.receivedPackets >>
+                entry.lostPackets &&
+            fileKey == key)
+        {
+            Promote(key, entry);
+            m_hits += 1;
+            return true;
+        }
+        m_file.clear();
+    }
+    m_misses += 1;
+    return false;
+}
+
+void
+RewardCache::Insert(const std::string& key, const RewardCacheEntry& entry)
+{
+    auto it = m_memory.find(key);
+    if (it != m_memory.end())
+    {
+        it->second->second = entry;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+    }
+    else
+    {
+        Promote(key, entry);
+    }
+    if (m_file.is_open())
+    {
+        m_file.seekp(0, std::ios::end);
+        m_disk[key] = m_file.tellp();
+        m_file << key << " " << std::setprecision(std::numeric_limits<double>::max_digits10)
+               << entry.qos << " " << entry.numPackets << " " << entry.receivedPackets << " "
+               << entry.lostPackets << "\n";
+        m_file.flush();
+    }
+}
+
+uint64_t
+RewardCache::GetHits() const
+{
+    return m_hits;
+}
+
+uint64_t
+RewardCache::GetMisses() const
+{
+    return m_misses;
+}
+
+void
+RewardCache::Promote(const std::string& key, const RewardCacheEntry& entry)
+{
+    if (m_capacity == 0)
+    {
+        return;
+    }
+    if (m_lru.size() == m_capacity)
+    {
+        m_memory.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+    m_lru.emplace_front(key, entry);
+    m_memory[key] = m_lru.begin();
+}
+
+} // namespace ns3
@@ -0,0 +1,101 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef REWARD_CACHE_H
+#define REWARD_CACHE_H
+
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace ns3
+{
+
+/**
+ * Result of a data collection window, as reported to the agent.
+ */
+struct RewardCacheEntry
+{
+    double qos;
+    int numPackets;
+    int receivedPackets;
+    int lostPackets;
+};
+
+/**
+ * Reward cache keyed by the UAV configuration.
+ *
+ * The memory tier is an LRU list of at most GetCapacity () entries. The disk
+ * tier is an append-only text file, one "key qos numPackets receivedPackets
+ * lostPackets" line per entry: only the offset of each line is kept in memory,
+ * and a line is read back (and promoted to the memory tier) when its key
+ * misses the memory tier. The file survives restarts and is reloaded by
+ * SetFile ().
+ */
+class RewardCache
+{
+  public:
+    RewardCache();
+    ~RewardCache();
+
+    /**
+     * Enables the disk tier, indexing the entries already in the file.
+     * @param filename: cache file, created when it does not exist
+     */
+    void SetFile(std::string filename);
+
+    void SetCapacity(uint32_t capacity);
+    uint32_t GetCapacity() const;
+
+    /**
+     * @param key: configuration key, without white space
+     * @param entry: filled in on a hit
+     * @return true on a hit in any tier
+     */
+    bool Lookup(const std::string& key, RewardCacheEntry& entry);
+
+    /**
+     * Stores the entry in the memory tier and appends it to the file.
+     */
+    void Insert(const std::string& key, const RewardCacheEntry& entry);
+
+    uint64_t GetHits() const;
+    uint64_t GetMisses() const;
+
+  private:
+    typedef std::list<std::pair<std::string, RewardCacheEntry>> LruList;
+
+    void Promote(const std::string& key, const RewardCacheEntry& entry);
+
+    uint32_t m_capacity;
+    uint64_t m_hits;
+    uint64_t m_misses;
+    LruList m_lru; // most recently used first
+    std::unordered_map<std::string, LruList::iterator> m_memory;
+    std::unordered_map<std::string, std::streamoff> m_disk; // key -> line offset
+    std::fstream m_file;
+};
+
+} // namespace ns3
+
+#endif /* REWARD_CACHE_H */
@@ -0,0 +1,152 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+
+#include "shm-channel.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+ShmChannel::ShmChannel()
+    : m_header(nullptr),
+      m_obs(nullptr),
+      m_actions(nullptr),
+      m_info(nullptr),
+      m_size(0),
+      m_stateFd(-1),
+      m_actionFd(-1)
+{
+}
+
+ShmChannel::~ShmChannel()
+{
+    Close();
+}
+
+bool
+ShmChannel::Open(std::string name, uint32_t obsSize, uint32_t actionSize, uint32_t infoCapacity)
+{
+    m_name = name;
+    m_size = sizeof(ShmHeader) + sizeof(uint32_t) * (obsSize + actionSize) + infoCapacity;
+    int fd = shm_open(("/" + m_name).c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, m_size) < 0)
+    {
+        std::cout << "Could not create the shared memory - '" << m_name
+                  << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    void* base = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        std::cout << "Could not map the shared memory - '" << m_name << "'" << std::endl;
+        return false;
+    }
+    std::memset(base, 0, m_size);
+    m_header = static_cast<ShmHeader*>(base);
+    m_obs = reinterpret_cast<uint32_t*>(m_header + 1);
+    m_actions = m_obs + obsSize;
+    m_info = reinterpret_cast<char*>(m_actions + actionSize);
+    m_header->version = SHM_VERSION;
+    m_header->obsSize = obsSize;
+    m_header->actionSize = actionSize;
+    m_header->infoCapacity = infoCapacity;
+    // The magic goes last: the agent waits for it before reading the layout
+    __atomic_store_n(&m_header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+    std::string statePipe = "/tmp/" + m_name + ".state";
+    std::string actionPipe = "/tmp/" + m_name + ".action";
+    if ((mkfifo(statePipe.c_str(), 0600) < 0 && errno != EEXIST) ||
+        (mkfifo(actionPipe.c_str(), 0600) < 0 && errno != EEXIST))
+    {
+        std::cout << "Could not create the pipes - '" << statePipe << "': " << std::strerror(errno)
+                  << std::endl;
+        return false;
+    }
+    // Both open calls block until the agent opens the other ends, in this order
+    m_stateFd = open(statePipe.c_str(), O_WRONLY);
+    m_actionFd = open(actionPipe.c_str(), O_RDONLY);
+    return m_stateFd >= 0 && m_actionFd >= 0;
+}
+
+void
+ShmChannel::WriteState(const std::vector<uint32_t>& obs,
+                       float reward,
+                       bool done,
+                       const std::string& info)
+{
+    std::copy_n(obs.begin(), std::min<size_t>(obs.size(), m_header->obsSize), m_obs);
+    m_header->reward = reward;
+    m_header->done = done;
+    m_header->infoSize = std::min<size_t>(info.size(), m_header->infoCapacity);
+    std::memcpy(m_info, info.data(), m_header->infoSize);
+    m_header->step += 1;
+    char bell = 1;
+    // The pipe write orders the segment writes before the agent's read
+    while (write(m_stateFd, &bell, 1) < 0 && errno == EINTR)
+    {
+    }
+}
+
+bool
+ShmChannel::WaitActions(std::vector<uint32_t>& actions)
+{
+    char bell;
+    ssize_t n;
+    while ((n = read(m_actionFd, &bell, 1)) < 0 && errno == EINTR)
+    {
+    }
+    if (n != 1)
+    {
+        return false;
+    }
+    actions.assign(m_actions, m_actions + m_header->actionSize);
+    return true;
+}
+
+void
+ShmChannel::Close()
+{
+    if (m_stateFd >= 0)
+    {
+        close(m_stateFd);
+        close(m_actionFd);
+        unlink(("/tmp/" + m_name + ".state").c_str());
+        unlink(("/tmp/" + m_name + ".action").c_str());
+        m_stateFd = m_actionFd = -1;
+    }
+    if (m_header)
+    {
+        munmap(m_header, m_size);
+        shm_unlink(("/" + m_name).c_str());
+        m_header = nullptr;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,111 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef SHM_CHANNEL_H
+#define SHM_CHANNEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Fixed layout of the shared-memory segment, followed by
+ * uint32_t observation[obsSize], uint32_t actions[actionSize] and
+ * char info[infoCapacity]. shm_env.py mirrors these offsets.
+ */
+struct ShmHeader
+{
+    uint32_t magic; // SHM_MAGIC
+    uint32_t version;
+    uint32_t obsSize;      // observation values
+    uint32_t actionSize;   // action values
+    uint32_t infoCapacity; // bytes
+    uint32_t infoSize;     // bytes of the last info
+    uint64_t step;         // states written so far
+    float reward;
+    uint32_t done;
+    uint8_t reserved[24];
+};
+
+static_assert(sizeof(ShmHeader) == 64, "ShmHeader layout is shared with shm_env.py");
+
+/**
+ * Step transport between the simulation and the agent over a POSIX
+ * shared-memory segment (/dev/shm/<name>).
+ *
+ * The state (observation, reward, done, info) is written in place and the
+ * actions are read in place, so nothing is serialized. Two named pipes,
+ * /tmp/<name>.state and /tmp/<name>.action, carry one-byte doorbells: the
+ * simulation rings the state pipe after writing a state and blocks on the
+ * action pipe until the agent has written its actions.
+ */
+class ShmChannel
+{
+  public:
+    static constexpr uint32_t SHM_MAGIC = 0x4c47594d; // "LGYM"
+    static constexpr uint32_t SHM_VERSION = 1;
+
+    ShmChannel();
+    ~ShmChannel();
+
+    /**
+     * Creates the segment and the pipes, then waits for the agent to attach.
+     * @return false when any of them cannot be created
+     */
+    bool Open(std::string name, uint32_t obsSize, uint32_t actionSize, uint32_t infoCapacity);
+
+    /**
+     * Publishes a state and rings the state doorbell. The info is truncated
+     * to the segment capacity.
+     */
+    void WriteState(const std::vector<uint32_t>& obs,
+                    float reward,
+                    bool done,
+                    const std::string& info);
+
+    /**
+     * Blocks until the agent rings the action doorbell.
+     * @param actions: filled with actionSize values
+     * @return false when the agent has closed the channel
+     */
+    bool WaitActions(std::vector<uint32_t>& actions);
+
+    /**
+     * Unmaps the segment and removes it and the pipes.
+     */
+    void Close();
+
+  private:
+    std::string m_name;
+    ShmHeader* m_header;
+    uint32_t* m_obs;
+    uint32_t* m_actions;
+    char* m_info;
+    size_t m_size;
+    int m_stateFd;
+    int m_actionFd;
+};
+
+} // namespace ns3
+
+#endif /* SHM_CHANNEL_H */
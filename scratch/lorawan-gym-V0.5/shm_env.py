@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Agent side of the shared-memory step channel of sim.cc (--shm=<name>).
+
+The observation, reward, done flag and info are read from /dev/shm/<name> as
+numpy views, and the actions are written in place, so a step does not
+serialize anything. One-byte doorbells go through the /tmp/<name>.state and
+/tmp/<name>.action pipes. Start the simulation first, it waits for the agent:
+
+    ./ns3 run "scratch/lorawan-gym-V0.5/sim --nDevices=10 --shm=lorawan0"
+
+    env = Ns3ShmEnv("lorawan0")
+    obs = env.reset()
+    obs, reward, done, info = env.step(3)
+
+The returned observation is a view of the segment: copy it to keep it across steps.
+"""
+
+import mmap
+import os
+import struct
+import time
+import numpy as np
+from fast_reset import RESET_ACTION
+
+__author__ = "Rogério S. Silva"
+__copyright__ = "Copyright (c) 2023, NumbERS - Federal Institute of Goiás, Inhumas - IFG"
+__version__ = "0.1.0"
+__email__ = "rogerio.sousa@ifg.edu.br"
+
+# ShmHeader of shm-channel.h
+SHM_MAGIC = 0x4c47594d
+SHM_VERSION = 1
+HEADER_SIZE = 64
+LAYOUT = struct.Struct("<6IQfI")
+
+
+class Ns3ShmEnv:
+    def __init__(self, name, timeout=60.0):
+        """
+        :param name: --shm value given to the simulation
+        :param timeout: seconds to wait for the simulation to create the channel
+        """
+        path = "/dev/shm/" + name
+        deadline = time.time() + timeout
+        while not os.path.exists(path) or os.path.getsize(path) < HEADER_SIZE:
+            if time.time() > deadline:
+                raise TimeoutError("Simulation channel not found: " + path)
+            time.sleep(0.1)
+        with open(path, "r+b") as f:
+            self._mm = mmap.mmap(f.fileno(), 0)
+        while struct.unpack_from("<I", self._mm, 0)[0] != SHM_MAGIC:
+            time.sleep(0.01)
+        magic, version, obs_size, action_size, info_capacity, _, _, _, _ = LAYOUT.unpack_from(self._mm, 0)
+        if version != SHM_VERSION:
+            raise RuntimeError("Unsupported channel version: " + str(version))
+        self.obs = np.ndarray((obs_size,), dtype=np.uint32, buffer=self._mm, offset=HEADER_SIZE)
+        self.actions = np.ndarray((action_size,), dtype=np.uint32, buffer=self._mm,
+                                  offset=HEADER_SIZE + 4 * obs_size)
+        self._info = np.ndarray((info_capacity,), dtype=np.uint8, buffer=self._mm,
+                                offset=HEADER_SIZE + 4 * (obs_size + action_size))
+        # Same order as the simulation, which opens the state pipe first
+        self._state = os.open("/tmp/" + name + ".state", os.O_RDONLY)
+        self._action = os.open("/tmp/" + name + ".action", os.O_WRONLY)
+        self._wait_state()
+
+    def get_state(self):
+        _, _, _, _, _, info_size, step, reward, done = LAYOUT.unpack_from(self._mm, 0)
+        info = self._info[:info_size].tobytes().decode()
+        return self.obs, reward, bool(done), info
+
+    def step(self, action):
+        """
+        :param action: action index, or one movement per UAV in joint action mode
+        """
+        self.actions[:] = action
+        os.write(self._action, b"\x01")
+        self._wait_state()
+        return self.get_state()
+
+    def reset(self):
+        """
+        Restarts the episode in-process, as fast_reset() does over ZMQ.
+        :return: first observation
+        """
+        return self.step(RESET_ACTION)[0]
+
+    def close(self):
+        os.close(self._action)
+        os.close(self._state)
+        self.obs = self.actions = self._info = None
+        self._mm.close()
+
+    def _wait_state(self):
+        if len(os.read(self._state, 1)) != 1:
+            raise EOFError("Simulation closed the channel")
@@ -54,11 +54,28 @@
 #include "ns3/stats-module.h"
 #include "ns3/traced-value.h"
 
+#include "../gateway-outcome-recorder.h"
+#include "../packet-status-tracker.h"
+#include "../placement-pack.h"
+#include "../trace-policy.h"
+#include "occupancy-grid.h"
+#include "path-loss-matrix.h"
+#include "reward-cache.h"
+#include "shm-channel.h"
+#include "step-telemetry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iomanip>
+#include <limits>
+#include <sstream>
 
 // QoS, Data rate and Delay
 #define MAX_RK 6835.94
 #define MIN_RK 183.11
+// LoRaWAN MAC header (1 byte) and frame header with FPort (8 bytes)
+#define MAC_OVERHEAD 9
 
 using namespace ns3;
 using namespace lorawan;
@@ -68,6 +85,9 @@ NS_LOG_COMPONENT_DEFINE("LoRaWAN-OpenAIGym");
 Ptr<OpenGymInterface> openGym;
 // Ptr<MobilityModel> mobility;
 ApplicationContainer applicationContainer = ApplicationContainer();
+Ptr<UniformRandomVariable> appInitialDelay;
+bool stepRearm = true; // install the applications once and restart them every data collection
+bool uavMoved = false;
 uint32_t nDevices = 0;
 uint32_t nGateways = 0;
 uint32_t env_action = 0;
@@ -87,38 +107,70 @@ bool vtime = false;
 bool vresults = false;
 bool vgym = false;
 bool vmodel = false;
+bool jointActions = false; // one movement per UAV on every step
+uint32_t minSeparation = 0; // lattice cells between UAVs, 0 only forbids sharing a cell
 const int packetSize = 50;
 // double applicationStart = 0; // 0.1 second after simulation start
 double applicationInterval = 10;
 // double applicationStop = 600; // 10 minutes
 double simulationStop = 600 * 10 * 50;
 bool impossible_movement = false;
-
-enum PacketOutcome
-{
-    _RECEIVED,
-    _INTERFERED,
-    _NO_MORE_RECEIVERS,
-    _UNDER_SENSITIVITY,
-    _UNSET
-};
-
-struct myPacketStatus
-{
-    Ptr<const Packet> packet;
-    uint32_t senderId;
-    uint32_t receiverId;
-    Time sentTime;
-    Time receivedTime;
-    uint8_t senderSF;
-    uint8_t receiverSF;
-    double senderTP;
-    double receiverTP;
-    uint32_t outcomeNumber;
-    std::vector<enum PacketOutcome> outcomes;
-};
-
-std::map<Ptr<const Packet>, myPacketStatus> packetTracker;
+// Action value that restarts the episode without restarting the simulation
+const uint32_t RESET_ACTION = 0xFFFFFFFF;
+const int64_t APP_DELAY_STREAM = 0;
+std::vector<Vector> episodeStartPositions;
+Vector latticeOrigin; // lowest position of the UAV movement lattice inside the area
+uint32_t episode = 0;
+
+// Analytic reward: link budget, time-on-air and ALOHA collisions instead of simulated traffic
+bool analyticFidelity = false;
+// The simulated window serves a device when at least one of its packets arrives; the analytic
+// one when that happens with at least this probability (0.5: more likely than not)
+double servedProbability = 0.5;
+uint32_t calibrationSteps = 0;
+uint32_t calibrationStep = 0;
+Ptr<UniformRandomVariable> calibrationMoves;
+std::vector<double> onAirTime; // seconds, {SF7, SF8, SF9, SF10, SF11, SF12}
+// Uplink sensitivity (Source: SX1301 datasheet) {SF7, SF8, SF9, SF10, SF11, SF12}
+const double gatewaySensitivity[6] = {-130.0, -132.5, -135.0, -137.5, -140.0, -142.5};
+// Received power thresholds of LorawanMacHelper::SetSpreadingFactorsUp {SF7, ..., SF12}
+const double spreadingFactorThreshold[6] = {-127.5, -130.0, -132.5, -135.0, -137.5, -140.0};
+
+PacketStatusTracker packetTracker;
+std::vector<Ptr<GatewayOutcomeRecorder>> outcomeRecorders;
+
+// UAVs per lattice cell
+OccupancyGrid occupancy;
+
+// Received power from the devices to every lattice cell, computed at startup
+PathLossMatrix lossMatrix;
+bool useLossMatrix = true;
+
+// Rewards of the UAV configurations already evaluated
+RewardCache rewardCache;
+bool rewardCacheEnabled = false;
+std::string rewardCachePrefix; // parameters part of the keys
+std::string stepKey;           // key of the configuration of the current step
+bool stepCached = false;       // the current step reuses a cached window
+RewardCacheEntry stepEntry;
+
+// Shared-memory step transport, used instead of the ZMQ interface when enabled
+ShmChannel shmChannel;
+const uint32_t SHM_INFO_CAPACITY = 4096;
+
+// Per-step performance telemetry
+StepTelemetry telemetry;
+bool telemetryInfo = false; // append the telemetry to the step info
+bool telemetryEnabled = false;
+StepSample stepSample;
+bool stepSamplePending = false; // stepSample not written to the telemetry file yet
+double lastIpcWall = 0;         // IPC time of the previous step, reported in the step info
+std::chrono::steady_clock::time_point windowStart; // the actions of the step were executed
+std::chrono::steady_clock::time_point stateSent;   // the state of the step was sent
+uint64_t windowEvents = 0;                         // simulator events at windowStart
+
+// Device and UAV placements of every seed and size, mapped from one file
+PlacementPack placementPack;
 
 NodeContainer endDevices;
 NodeContainer gateways;
@@ -136,28 +188,60 @@ int numPackets = 0;
 int lostPackets = 0;
 int receivedPackets = 0;
 
+// Per-device QoS running sums, updated by the transmission and reception callbacks
+struct DeviceQos
+{
+    uint8_t sf;           // SF of the first packet in the window
+    uint32_t transmitted; // packets sent in the window
+    uint32_t samples;     // packets received with a positive delay
+    double rkSum;         // data rate (bits/s)
+    double dkSum;         // delay (s)
+};
+
+std::vector<DeviceQos> deviceQos;
+uint32_t servedDevices = 0;
+
 /***********************
  * Callback Functions  *
  **********************/
-void CheckReceptionByAllGWsComplete(std::map<Ptr<const Packet>, myPacketStatus>::iterator it);
+void CheckReceptionByAllGWsComplete(uint32_t slot);
 void TransmissionCallback(Ptr<const Packet> packet, uint32_t systemId);
-void PacketReceptionCallback(Ptr<const Packet> packet, uint32_t systemId);
-void InterferenceCallback(Ptr<const Packet> packet, uint32_t systemId);
-void NoMoreReceiversCallback(Ptr<const Packet> packet, uint32_t systemId);
-void UnderSensitivityCallback(Ptr<const Packet> packet, uint32_t systemId);
+void FirstReceptionCallback(uint32_t slot);
 void CourseChangeDetection(std::string context, Ptr<const MobilityModel> model);
 
 /**********************
  * Utility Functions  *
  **********************/
 void ScheduleNextStateRead();
+void ScheduleNextShmStateRead();
+void TelemetryStateRead();
+void TelemetryFlush();
+double GetWallTime(std::chrono::steady_clock::time_point since);
 void ScheduleNextDataCollect();
+void StopDataCollect();
 void TrackersReset();
+void ResetEpisode();
+void ComputeOnAirTimes();
+double AnalyticQos();
+void CalibrationStep();
+double QosToReward(double qos);
+std::vector<const float*> GetGatewayColumns();
+uint32_t GetBestGateway(uint32_t device, const std::vector<const float*>& columns, double& rxPower);
+uint8_t GetSpreadingFactor(double rxPower);
+void SetSpreadingFactorsUp();
+bool IsResetAction(Ptr<OpenGymDataContainer> action);
+std::string GetConfigurationKey();
+void LookupStep();
 Ptr<ListPositionAllocator> NodesPlacement(std::string filename);
 void DoSetInitialPositions();
-void FindNewPosition(uint32_t action);
+void FindNewPosition(uint32_t action, uint32_t uavNumber);
+void FindNewPositions(const std::vector<uint32_t>& actions);
+void SetLatticeOrigin();
+void UpdateOccupancy();
+Vector GetTargetPosition(uint32_t action, Vector uav_position);
 double PrintData();
 bool GetCollisionStatus(uint32_t uavNumber, Vector newPosition);
+uint32_t GetCollisionStatus(const std::vector<Vector>& positions, std::vector<Vector>& targets);
 
 /**********************
  * OPENGYM Functions  *
@@ -177,6 +261,12 @@ main(int argc, char* argv[])
     double reward = 0.0;
     uint32_t openGymPort = 5555;
     bool up = true;
+    std::string fidelity = "full";
+    std::string rewardCacheFile = "";
+    uint32_t rewardCacheSize = 1024;
+    std::string shmName = "";
+    std::string telemetryFile = "";
+    std::string placementPackFile = "";
 
     CommandLine cmd;
     cmd.AddValue("openGymPort", "Port number for OpenGym env. Default: 5555", openGymPort);
@@ -192,9 +282,88 @@ main(int argc, char* argv[])
     cmd.AddValue("simSeed", "Seed", simSeed);
     cmd.AddValue("reward", "Initial Reward", reward);
     cmd.AddValue("step", "UAVs movement step. Default:1000", movementStep);
+    cmd.AddValue("rearm",
+                 "Restart the applications installed at startup on every step instead of "
+                 "installing new ones. Default: true",
+                 stepRearm);
+    cmd.AddValue("jointActions",
+                 "Move every UAV on each step (Box action space, one movement per UAV). "
+                 "Default: false",
+                 jointActions);
+    cmd.AddValue("minSeparation",
+                 "Minimum distance between UAVs, in movement steps (0: only collisions). "
+                 "Default: 0",
+                 minSeparation);
+    cmd.AddValue("fidelity",
+                 "Reward fidelity: full (simulated traffic) or analytic (link budget). "
+                 "Default: full",
+                 fidelity);
+    cmd.AddValue("servedProbability",
+                 "Analytic fidelity: probability of at least one packet of a device arriving in "
+                 "the window above which the device is served. Default: 0.5",
+                 servedProbability);
+    cmd.AddValue("calibrate",
+                 "Compare the analytic and the full reward on this number of random UAV "
+                 "configurations, without the gym agent. Default: 0",
+                 calibrationSteps);
+    cmd.AddValue("rewardCache",
+                 "File of the persistent reward cache, disabled when empty. Default: empty",
+                 rewardCacheFile);
+    cmd.AddValue("rewardCacheSize",
+                 "Entries of the in-memory reward cache. Default: 1024",
+                 rewardCacheSize);
+    cmd.AddValue("lossMatrix",
+                 "Precompute the received power from the devices to every UAV lattice cell. "
+                 "Default: true",
+                 useLossMatrix);
+    cmd.AddValue("telemetry",
+                 "File of the per-step telemetry, CSV or JSON lines (.json, .jsonl). "
+                 "Default: empty",
+                 telemetryFile);
+    cmd.AddValue("telemetryInfo",
+                 "Append the per-step telemetry to the step info. Default: false",
+                 telemetryInfo);
+    cmd.AddValue("shm",
+                 "Name of the shared-memory step channel (shm_env.py), replacing the ZMQ "
+                 "interface when set. Default: empty",
+                 shmName);
+    cmd.AddValue("placementPack",
+                 "Placement pack (pack_placements.py) read instead of the placement files it "
+                 "holds. Default: empty",
+                 placementPackFile);
 
     cmd.Parse(argc, argv);
     env_action_space_size = 4 * nGateways;
+    if (fidelity != "full" && fidelity != "analytic")
+    {
+        NS_FATAL_ERROR("Unknown fidelity: " << fidelity);
+    }
+    // Calibration needs the simulated traffic as reference
+    analyticFidelity = fidelity == "analytic" && calibrationSteps == 0;
+    rewardCacheEnabled = !rewardCacheFile.empty() && calibrationSteps == 0;
+    if (!telemetryFile.empty() && !telemetry.Open(telemetryFile))
+    {
+        NS_FATAL_ERROR("Could not open the telemetry file " << telemetryFile);
+    }
+    telemetryEnabled = (telemetry.IsOpen() || telemetryInfo) && calibrationSteps == 0;
+    if (!placementPackFile.empty() && !placementPack.Open(placementPackFile))
+    {
+        NS_FATAL_ERROR("Could not open the placement pack " << placementPackFile);
+    }
+    if (rewardCacheEnabled)
+    {
+        rewardCache.SetCapacity(rewardCacheSize);
+        rewardCache.SetFile(rewardCacheFile);
+        // Every parameter that changes the reward of a configuration, as the file
+        // is reused across runs
+        std::ostringstream prefix;
+        prefix << simSeed << "s" << nDevices << "d" << (analyticFidelity ? "a" : "f") << envStepTime
+               << "t" << applicationInterval << "i" << packetSize << "b" << up << "u" << stepRearm
+               << "r" << movementStep << "m" << area_bounds.xMin << "," << area_bounds.xMax << ","
+               << area_bounds.yMin << "," << area_bounds.yMax << "," << area_bounds.zMin << ","
+               << area_bounds.zMax << "a";
+        rewardCachePrefix = prefix.str();
+    }
 
     if (vgym)
     {
@@ -294,49 +463,66 @@ main(int argc, char* argv[])
     mobilityGW.SetMobilityModel("ns3::ConstantPositionMobilityModel");
     mobilityGW.SetPositionAllocator(gatewaysPositions);
     mobilityGW.Install(gateways);
+    for (auto g = gateways.Begin(); g != gateways.End(); ++g)
+    {
+        episodeStartPositions.push_back((*g)->GetObject<MobilityModel>()->GetPosition());
+    }
+    SetLatticeOrigin();
+    occupancy.SetLattice(area_bounds, latticeOrigin, movementStep);
+    UpdateOccupancy();
+    if (useLossMatrix)
+    {
+        // Devices transmit at 14 dBm
+        lossMatrix.Compute(loss, endDevices, area_bounds, latticeOrigin, movementStep, 14);
+        if (vmodel)
+            NS_LOG_INFO("Loss matrix: " << lossMatrix.GetDevices() << " devices x "
+                                        << lossMatrix.GetCells() << " cells");
+    }
 
     // Create a net device for each gateway
     phyHelper.SetDeviceType(LoraPhyHelper::GW);
     macHelper.SetDeviceType(LorawanMacHelper::GW);
     helper.Install(phyHelper, macHelper, gateways);
 
-    for (auto g = gateways.Begin(); g != gateways.End(); ++g)
+    // Packets tracing callbacks, one recorder per gateway
+    outcomeRecorders =
+        GatewayOutcomeRecorder::Install(gateways,
+                                        packetTracker,
+                                        MakeCallback(&FirstReceptionCallback),
+                                        MakeCallback(&CheckReceptionByAllGWsComplete));
+    // Mobility CourseChange Callback, which only traces the movements
+    if constexpr (TracePolicy::enabled)
     {
-        Ptr<Node> object = *g;
-        Ptr<NetDevice> netDevice = object->GetDevice(0);
-        Ptr<LoraNetDevice> loraNetDevice = netDevice->GetObject<LoraNetDevice>();
-        Ptr<GatewayLoraPhy> gwPhy = loraNetDevice->GetPhy()->GetObject<GatewayLoraPhy>();
-        // Packets tracing callbacks
-        gwPhy->TraceConnectWithoutContext("ReceivedPacket", MakeCallback(&PacketReceptionCallback));
-        gwPhy->TraceConnectWithoutContext("LostPacketBecauseInterference",
-                                          MakeCallback(&InterferenceCallback));
-        gwPhy->TraceConnectWithoutContext("LostPacketBecauseNoMoreReceivers",
-                                          MakeCallback(&NoMoreReceiversCallback));
-        gwPhy->TraceConnectWithoutContext("LostPacketBecauseUnderSensitivity",
-                                          MakeCallback(&UnderSensitivityCallback));
-        // Mobility CourseChange Callback
-        std::ostringstream oss;
-        oss.str("");
-        oss << "/NodeList/" << object->GetId() << "/$ns3::MobilityModel/CourseChange";
-        Config::Connect(oss.str(), MakeCallback(&CourseChangeDetection));
-        if (vcallbacks)
-            NS_LOG_INFO("CallBack Connected on: " << oss.str());
+        for (auto g = gateways.Begin(); g != gateways.End(); ++g)
+        {
+            Ptr<Node> object = *g;
+            std::ostringstream oss;
+            oss.str("");
+            oss << "/NodeList/" << object->GetId() << "/$ns3::MobilityModel/CourseChange";
+            Config::Connect(oss.str(), MakeCallback(&CourseChangeDetection));
+            if (vcallbacks)
+                NS_LOG_INFO("CallBack Connected on: " << oss.str());
+        }
     }
 
     /************************************
      *  Create the openGym environment  *
      ************************************/
-    openGym = CreateObject<OpenGymInterface>(openGymPort);
-    openGym->SetGetActionSpaceCb(MakeCallback(&GetActionSpace));
-    openGym->SetGetObservationSpaceCb(MakeCallback(&GetObservationSpace));
-    openGym->SetGetGameOverCb(MakeCallback(&GetGameOver));
-    openGym->SetGetObservationCb(MakeCallback(&GetObservation));
-    openGym->SetGetRewardCb(MakeCallback(&GetReward));
-    openGym->SetGetExtraInfoCb(MakeCallback(&GetExtraInfo));
-    openGym->SetExecuteActionsCb(MakeCallback(&ExecuteActions));
+    if (calibrationSteps == 0 && shmName.empty())
+    {
+        openGym = CreateObject<OpenGymInterface>(openGymPort);
+        openGym->SetGetActionSpaceCb(MakeCallback(&GetActionSpace));
+        openGym->SetGetObservationSpaceCb(MakeCallback(&GetObservationSpace));
+        openGym->SetGetGameOverCb(MakeCallback(&GetGameOver));
+        openGym->SetGetObservationCb(MakeCallback(&GetObservation));
+        openGym->SetGetRewardCb(MakeCallback(&GetReward));
+        openGym->SetGetExtraInfoCb(MakeCallback(&GetExtraInfo));
+        openGym->SetExecuteActionsCb(MakeCallback(&ExecuteActions));
+    }
+    ComputeOnAirTimes();
 
     // Force ADR
-    ns3::lorawan::LorawanMacHelper::SetSpreadingFactorsUp(endDevices, gateways, channel);
+    SetSpreadingFactorsUp();
 
     /**************************
      *  Create Network Server  *'
@@ -354,7 +540,42 @@ main(int argc, char* argv[])
      *  Schedule applications                    *
      *********************************************/
 
-    Simulator::Schedule(Seconds(700), &ScheduleNextStateRead);
+    // The analytic fidelity has no traffic to simulate
+    if (stepRearm && !analyticFidelity)
+    {
+        PeriodicSenderHelper periodicSenderHelper;
+        periodicSenderHelper.SetPeriod(Seconds(applicationInterval));
+        periodicSenderHelper.SetPacketSize(packetSize);
+        applicationContainer = periodicSenderHelper.Install(endDevices);
+        ForwarderHelper forHelper = ForwarderHelper();
+        forHelper.Install(gateways);
+        appInitialDelay = CreateObject<UniformRandomVariable>();
+        appInitialDelay->SetStream(APP_DELAY_STREAM);
+    }
+
+    if (calibrationSteps > 0)
+    {
+        calibrationMoves = CreateObject<UniformRandomVariable>();
+        std::cout << "calibration step simulated analytic" << std::endl;
+        Simulator::Schedule(Seconds(700), &CalibrationStep);
+    }
+    else if (!shmName.empty())
+    {
+        // GetObservation writes x, y and z of every UAV
+        if (!shmChannel.Open(shmName,
+                             3 * nGateways,
+                             jointActions ? nGateways : 1,
+                             SHM_INFO_CAPACITY))
+        {
+            NS_FATAL_ERROR("Could not open the shared-memory channel " << shmName);
+        }
+        Simulator::Schedule(Seconds(700), &ScheduleNextShmStateRead);
+    }
+    else
+    {
+        Simulator::Schedule(Seconds(700), &ScheduleNextStateRead);
+    }
+    LookupStep();
     ScheduleNextDataCollect();
     if (vmodel)
         NS_LOG_INFO("Completed configuration");
@@ -362,10 +583,16 @@ main(int argc, char* argv[])
     /****************
      *  Simulation  *
      ****************/
+    windowStart = std::chrono::steady_clock::now();
     Simulator::Run();
     if (vmodel)
         NS_LOG_INFO("Computing performance metrics...");
-    openGym->NotifySimulationEnd();
+    TelemetryFlush();
+    if (openGym)
+    {
+        openGym->NotifySimulationEnd();
+    }
+    shmChannel.Close();
     Simulator::Destroy();
     if (vmodel)
         NS_LOG_INFO("Simulation finished");
@@ -379,42 +606,25 @@ main(int argc, char* argv[])
 Ptr<ListPositionAllocator>
 NodesPlacement(std::string filename)
 {
-    double edX = 0.0;
-    double edY = 0.0;
-    double edZ = 0.0;
-    Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator>();
-    const char* c = filename.c_str();
-    // Get Devices position from File
-    std::ifstream in_File(c);
-    if (!in_File)
+    // From the placement pack when it holds this file
+    Ptr<ListPositionAllocator> allocator = placementPack.Load(filename);
+    if (allocator->GetSize() == 0)
     {
         if (vmodel)
             NS_LOG_INFO("Could not open the file - '" << filename << "'");
     }
-    else
-    {
-        while (in_File >> edX >> edY >> edZ)
-        {
-            allocator->Add(Vector(edX, edY, edZ));
-        }
-        in_File.close();
-    }
     return allocator;
 }
 
 /**
- * Find the new position of the node.
- * In case of area violation, a penalty is notified to the GYM
+ * Position reached by a UAV after a movement action. A movement that would
+ * leave the area is notified to the GYM as a penalty and the UAV stays.
+ * Actions other than the four movements (e.g. 4 in joint actions) keep the
+ * UAV in place.
  */
-
-void
-FindNewPosition(uint32_t action, uint32_t uavNumber)
+Vector
+GetTargetPosition(uint32_t action, Vector uav_position)
 {
-    Ptr<MobilityModel> gwMob;
-    gwMob = gateways.Get(uavNumber)->GetObject<MobilityModel>();
-    Vector uav_position = gwMob->GetPosition();
-
-    // Find a new position from the new state obtained from the GYM
     Vector new_pos = uav_position;
 
     // Check the possibility of executing the movement,
@@ -461,6 +671,23 @@ FindNewPosition(uint32_t action, uint32_t uavNumber)
             new_pos = Vector(uav_position.x + movementStep, uav_position.y, uav_position.z);
         }
     }
+    return new_pos;
+}
+
+/**
+ * Find the new position of the node.
+ * In case of area violation, a penalty is notified to the GYM
+ */
+
+void
+FindNewPosition(uint32_t action, uint32_t uavNumber)
+{
+    Ptr<MobilityModel> gwMob;
+    gwMob = gateways.Get(uavNumber)->GetObject<MobilityModel>();
+    Vector uav_position = gwMob->GetPosition();
+
+    // Find a new position from the new state obtained from the GYM
+    Vector new_pos = GetTargetPosition(action, uav_position);
     if (impossible_movement)
     {
         // Movement to outside the area is not allowed
@@ -475,6 +702,9 @@ FindNewPosition(uint32_t action, uint32_t uavNumber)
         if (!GetCollisionStatus(uavNumber, new_pos))
         {
             gwMob->SetPosition(new_pos); // the movement
+            occupancy.Remove(uav_position);
+            occupancy.Add(new_pos);
+            uavMoved = true;
         }
         else
         {
@@ -483,130 +713,153 @@ FindNewPosition(uint32_t action, uint32_t uavNumber)
     }
 }
 
-bool
-GetCollisionStatus(uint32_t uavNumber, Vector newPosition)
+/**
+ * Find the new positions of all UAVs, moving simultaneously.
+ * Each UAV that would leave the area or collide stays in place, the others move.
+ */
+void
+FindNewPositions(const std::vector<uint32_t>& actions)
 {
-    for (auto g = gateways.Begin(); g != gateways.End(); ++g)
+    std::vector<Vector> positions(nGateways);
+    std::vector<Vector> targets(nGateways);
+    for (uint32_t i = 0; i < nGateways; ++i)
     {
-        Ptr<Node> object = *g;
-        Ptr<NetDevice> netDevice = object->GetDevice(0);
-        Ptr<MobilityModel> mobility = netDevice->GetNode()->GetObject<MobilityModel>();
-        Vector uav_position = mobility->GetPosition();
-        if (uavNumber != object->GetId() - nDevices)
+        positions[i] = gateways.Get(i)->GetObject<MobilityModel>()->GetPosition();
+        targets[i] = GetTargetPosition(i < actions.size() ? actions[i] : 4, positions[i]);
+    }
+    if (impossible_movement && vmodel)
+    {
+        // Movement to outside the area is not allowed
+        NS_LOG_INFO("A movement is not allowed; that node position has not changed!");
+    }
+
+    uint32_t collisions = GetCollisionStatus(positions, targets);
+    if (collisions > 0)
+    {
+        NS_LOG_INFO(collisions << " possible collisions were detected; those UAVs have not moved!");
+    }
+
+    for (uint32_t i = 0; i < nGateways; ++i)
+    {
+        if (targets[i] != positions[i])
         {
-            if (uav_position == newPosition)
-            {
-                return true;
-            }
+            gateways.Get(i)->GetObject<MobilityModel>()->SetPosition(targets[i]); // the movement
+            occupancy.Remove(positions[i]);
+            occupancy.Add(targets[i]);
+            uavMoved = true;
         }
     }
-    return false;
+}
+
+/**
+ * Sets the origin of the lattice shared by the occupancy grid, the loss
+ * matrix and the reward cache keys. The UAVs only move in whole steps, so the
+ * lattice goes through the first start position (the placement files put the
+ * UAVs at 500 + k * 1000, off the corner of the area); every other start
+ * position must be on it.
+ */
+void
+SetLatticeOrigin()
+{
+    latticeOrigin = Vector(area_bounds.xMin, area_bounds.yMin, area_bounds.zMin);
+    if (episodeStartPositions.empty())
+    {
+        return;
+    }
+    const Vector& anchor = episodeStartPositions[0];
+    // First lattice line at or after the lower bound on each axis
+    latticeOrigin.x =
+        anchor.x - std::floor((anchor.x - area_bounds.xMin) / movementStep) * movementStep;
+    latticeOrigin.y =
+        anchor.y - std::floor((anchor.y - area_bounds.yMin) / movementStep) * movementStep;
+    for (const Vector& start : episodeStartPositions)
+    {
+        double i = std::round((start.x - latticeOrigin.x) / movementStep);
+        double j = std::round((start.y - latticeOrigin.y) / movementStep);
+        // Tolerate the rounding of positions built from sums of steps
+        if (std::abs(start.x - (latticeOrigin.x + i * movementStep)) > 1e-6 * movementStep ||
+            std::abs(start.y - (latticeOrigin.y + j * movementStep)) > 1e-6 * movementStep)
+        {
+            NS_FATAL_ERROR("UAV start position " << start << " is not a whole number of steps "
+                                                 << "away from " << anchor);
+        }
+    }
+}
+
+/**
+ * Rebuilds the occupancy grid from the UAV positions.
+ */
+void
+UpdateOccupancy()
+{
+    occupancy.Clear();
+    for (auto g = gateways.Begin(); g != gateways.End(); ++g)
+    {
+        occupancy.Add((*g)->GetObject<MobilityModel>()->GetPosition());
+    }
+}
+
+bool
+GetCollisionStatus(uint32_t uavNumber, Vector newPosition)
+{
+    // The UAV does not block its own movement
+    Vector uav_position = gateways.Get(uavNumber)->GetObject<MobilityModel>()->GetPosition();
+    occupancy.Remove(uav_position);
+    bool collision = !occupancy.IsFree(newPosition, minSeparation);
+    occupancy.Add(uav_position);
+    return collision;
+}
+
+/**
+ * Resolves the collisions of simultaneous movements. A UAV cannot move to a
+ * position that another UAV holds or moves to at the end of the step (nor
+ * within minSeparation of it), and two UAVs cannot swap positions. Those UAVs
+ * stay in place, see OccupancyGrid::ValidateMoves.
+ * @param positions: current UAV positions
+ * @param targets: UAV positions after the movements, updated in place
+ * @return number of movements cancelled
+ */
+uint32_t
+GetCollisionStatus(const std::vector<Vector>& positions, std::vector<Vector>& targets)
+{
+    return occupancy.ValidateMoves(positions, targets, minSeparation);
 }
 
 double
 PrintData()
 {
-    // Vector composition:
-    // i:: device, j[0] sf j[1] data rate j[2] delay
-    std::vector<std::vector<double>> deviceData;
-    std::vector<std::vector<std::vector<double>>> deviceSimulatedData;
     double sumQos = 0.0;
     double mean_qos = 0.0;
     if (vresults)
         NS_LOG_INFO("Collecting package data!");
 
-    deviceSimulatedData.reserve(nDevices);
-    for (uint32_t i = 0; i < nDevices; ++i)
-    {
-        deviceSimulatedData.push_back({{}, {}, {}});
-    }
-
-    lorawan::LoraTag tag;
-    if (vresults)
-        NS_LOG_UNCOND("Devices Simulated Results...");
-
-    for (auto p = packetTracker.begin(); p != packetTracker.end(); ++p)
+    if (numPackets == 0)
     {
-        numPackets += 1;
-        (*p).second.packet->PeekPacketTag(tag);
-        if ((*p).second.receiverId == 0)
-        {
-            lostPackets++;
-        }
-        else
-        {
-            receivedPackets++;
-        }
-
-        double size = (*p).second.packet->GetSize() * 8; // bits
-        int devID = (*p).second.senderId;
-        double sf;
-        sf = ((*p).second.senderSF);
-        double dk;
-        dk = ((*p).second.receivedTime.GetSeconds() - (*p).second.sentTime.GetSeconds());
-        double rk;
-        rk = (size / ((*p).second.receivedTime.GetSeconds() - (*p).second.sentTime.GetSeconds()));
-        deviceSimulatedData[devID][0].push_back(sf);
-        deviceSimulatedData[devID][1].push_back(rk);
-        deviceSimulatedData[devID][2].push_back(dk);
+        return -1;
     }
-    if (numPackets == 0)
+    if (servedDevices < nDevices)
     {
+        if (vresults)
+            NS_LOG_UNCOND("There are unserved devices!");
         return -1;
     }
-    std::vector<std::vector<double>> deviceSummarizedData;
-    sumQos = 0.0;
+
+    if (vresults)
+        NS_LOG_UNCOND("Devices Simulated Results...");
     for (uint32_t devID = 0; devID < nDevices; ++devID)
     {
-        if (deviceSimulatedData[devID][0].empty())
-        {
-            continue;
-        }
-        double dk = 0;
-        double rk = 0;
-        double sf = deviceSimulatedData[devID][0][0];
-        double qos = 0;
-        int qtd = 0;
-        // depurar aqui prá contornar o SIGSEGV
-        // O VETOR NÃO TÁ COMPLETO
-        for (unsigned int i = 0; i < deviceSimulatedData[devID][0].size(); ++i)
-        {
-            if (deviceSimulatedData[devID][2].at(i) > 0.0)
-            {
-                rk += deviceSimulatedData[devID][1].at(i);
-                dk += deviceSimulatedData[devID][2].at(i);
-                qtd += 1;
-            }
-            else
-            {
-                deviceSimulatedData[devID][0].erase(deviceSimulatedData[devID][0].begin() + i);
-                deviceSimulatedData[devID][1].erase(deviceSimulatedData[devID][1].begin() + i);
-                deviceSimulatedData[devID][2].erase(deviceSimulatedData[devID][2].begin() + i);
-            }
-        }
+        const DeviceQos& device = deviceQos[devID];
+        double rk = device.rkSum / device.samples;
+        double dk = device.dkSum / device.samples;
         // Device QoS
-        qos = (rk / qtd) / MAX_RK + (1 - ((dk / qtd) / MIN_RK));
-        deviceSummarizedData.push_back({sf, rk / qtd, dk / qtd, qos});
+        double qos = rk / MAX_RK + (1 - (dk / MIN_RK));
         sumQos += qos;
+        if (vresults)
+            NS_LOG_UNCOND(devID << " " << unsigned(device.sf) << " " << rk << " " << dk << " "
+                                << qos);
     }
     // Gateways QoS
     mean_qos = sumQos / nDevices;
-    if (deviceSummarizedData.size() < nDevices)
-    {
-        if (vresults)
-            NS_LOG_UNCOND("There are unserved devices!");
-        return -1;
-    }
-    else
-    {
-        for (uint32_t i = 0; i < nDevices; ++i)
-        {
-            if (vresults)
-                NS_LOG_UNCOND(i << " " << deviceSummarizedData[i][0] << " "
-                                << deviceSummarizedData[i][1] << " " << deviceSummarizedData[i][2]
-                                << " " << deviceSummarizedData[i][3]);
-        }
-    }
     if (isNaN(mean_qos)) // || mean_qos < QOS_THRESHOLD)
     {
         if (vresults)
@@ -631,162 +884,192 @@ PrintData()
 }
 
 void
-CheckReceptionByAllGWsComplete(std::map<Ptr<const Packet>, myPacketStatus>::iterator it)
+CheckReceptionByAllGWsComplete(uint32_t slot)
 {
-    // Check whether this packet is received by all gateways
-    if ((*it).second.outcomeNumber == nGateways)
+    // Called once this packet has an outcome at every gateway: update the statistics
+    for (uint32_t j = 0; j < nGateways; j++)
     {
-        // Update the statistics
-        myPacketStatus status = (*it).second;
-        for (uint32_t j = 0; j < nGateways; j++)
+        switch (packetTracker.GetOutcome(slot, j))
         {
-            switch (status.outcomes.at(j))
-            {
-            case _RECEIVED: {
-                pkt_received += 1;
-                break;
-            }
-            case _UNDER_SENSITIVITY: {
-                pkt_underSensitivity += 1;
-                break;
-            }
-            case _NO_MORE_RECEIVERS: {
-                pkt_noMoreReceivers += 1;
-                break;
-            }
-            case _INTERFERED: {
-                pkt_interfered += 1;
-                break;
-            }
-            case _UNSET: {
-                break;
-            }
-            }
+        case _RECEIVED: {
+            pkt_received += 1;
+            break;
+        }
+        case _UNDER_SENSITIVITY: {
+            pkt_underSensitivity += 1;
+            break;
+        }
+        case _NO_MORE_RECEIVERS: {
+            pkt_noMoreReceivers += 1;
+            break;
+        }
+        case _INTERFERED: {
+            pkt_interfered += 1;
+            break;
+        }
+        case _UNSET: {
+            break;
+        }
         }
-        // Remove the packet from the tracker
-        //              packetTracker.erase (it);
     }
+    packetTracker.Retire(slot);
 }
 
 void
 TransmissionCallback(Ptr<const Packet> packet, uint32_t systemId)
 {
-    if (vcallbacks)
-        NS_LOG_INFO("Transmitted a packet from device " << systemId << " at "
-                                                        << Simulator::Now().GetSeconds());
-    LoraTag tag;
-    packet->PeekPacketTag(tag);
-
-    myPacketStatus status;
-    status.packet = packet;
-    status.senderId = systemId;
-    status.sentTime = Simulator::Now();
-    status.outcomeNumber = 0;
-    status.outcomes = std::vector<enum PacketOutcome>(nGateways, _UNSET);
-    status.senderSF = tag.GetSpreadingFactor();
-
-    packetTracker.insert(std::pair<Ptr<const Packet>, myPacketStatus>(packet, status));
+    TRACE_INFO_IF(vcallbacks,
+                  "Transmitted a packet from device " << systemId << " at "
+                                                      << Simulator::Now().GetSeconds());
+    uint32_t slot = GatewayOutcomeRecorder::RecordTransmission(packetTracker, packet, systemId);
+    const PacketRecord& status = packetTracker.Get(slot);
+
+    DeviceQos& device = deviceQos[systemId];
+    if (device.transmitted == 0)
+    {
+        device.sf = status.senderSF;
+        servedDevices += 1;
+    }
+    device.transmitted += 1;
+
     pkt_transmitted += 1;
+    numPackets += 1;
+    lostPackets += 1;
 }
 
+/**
+ * First reception of a packet, by any gateway: it is no longer lost and
+ * contributes to the QoS of its device.
+ */
 void
-PacketReceptionCallback(Ptr<const Packet> packet, uint32_t systemId)
+FirstReceptionCallback(uint32_t slot)
 {
-    // Remove the successfully received packet from the list of sent ones
-    if (vcallbacks)
-        NS_LOG_INFO("A packet was successfully received at gateway "
-                    << systemId << " at " << Simulator::Now().GetSeconds());
-    LoraTag tag;
-    packet->PeekPacketTag(tag);
-
-    auto it = packetTracker.find(packet);
-
-    if (it != packetTracker.end())
+    const PacketRecord& status = packetTracker.Get(slot);
+    TRACE_INFO_IF(vcallbacks,
+                  "A packet was successfully received at gateway "
+                      << status.receiverId << " at " << Simulator::Now().GetSeconds());
+    lostPackets -= 1;
+    receivedPackets += 1;
+
+    double dk = (status.receivedTime - status.sentTime).GetSeconds();
+    if (dk > 0.0)
     {
-        if ((*it).first == packet)
-        {
-            (*it).second.outcomes.at(systemId - nDevices) = _RECEIVED;
-            (*it).second.outcomeNumber += 1;
-            if ((*it).second.receivedTime == Seconds(0))
-            {
-                (*it).second.receivedTime = Simulator::Now();
-                (*it).second.receiverId = systemId;
-                //          cc++;
-            }
-            (*it).second.receiverSF = tag.GetSpreadingFactor();
-            (*it).second.receiverTP = tag.GetReceivePower();
-
-            CheckReceptionByAllGWsComplete(it);
-        }
+        DeviceQos& device = deviceQos[status.senderId];
+        device.rkSum += status.size * 8 / dk;
+        device.dkSum += dk;
+        device.samples += 1;
     }
 }
 
 void
-InterferenceCallback(Ptr<const Packet> packet, uint32_t systemId)
+CourseChangeDetection(std::string context, Ptr<const MobilityModel> model)
 {
-    if (vcallbacks)
-        NS_LOG_INFO("A packet was lost because of interference at gateway "
-                    << systemId << " at " << Simulator::Now().GetSeconds());
-    auto it = packetTracker.find(packet);
-    if ((*it).first == packet)
-    {
-        (*it).second.outcomes.at(systemId - nDevices) = _INTERFERED;
-        (*it).second.outcomeNumber += 1;
-        CheckReceptionByAllGWsComplete(it);
-    }
+    Vector uav_position = model->GetPosition();
+    TRACE_INFO_IF(vcallbacks,
+                  context << " x = " << uav_position.x << ", y = " << uav_position.y
+                          << ", z = " << uav_position.z);
 }
 
+/**
+ * OPENGYM ENVIRONMENT FUNCTIONS
+ * */
+
 void
-NoMoreReceiversCallback(Ptr<const Packet> packet, uint32_t systemId)
+ScheduleNextStateRead()
 {
-    if (vcallbacks)
-        NS_LOG_INFO("A packet was lost because there were no more receivers at gateway "
-                    << systemId << " at " << Simulator::Now().GetSeconds());
-    auto it = packetTracker.find(packet);
+    if (vtime)
+        NS_LOG_INFO("NowNSR: " << Simulator::Now().GetSeconds());
+    Simulator::Schedule(Seconds(700), &ScheduleNextStateRead);
+    TelemetryStateRead();
+    openGym->NotifyCurrentState();
+}
 
-    if ((*it).first == packet)
-    {
-        (*it).second.outcomes.at(systemId - nDevices) = _NO_MORE_RECEIVERS;
-        (*it).second.outcomeNumber += 1;
-    }
-    CheckReceptionByAllGWsComplete(it);
+double
+GetWallTime(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
 }
 
+/**
+ * Starts the telemetry sample of a step when its window has been simulated.
+ * The reward and IPC times are added by GetReward and ExecuteActions.
+ */
 void
-UnderSensitivityCallback(Ptr<const Packet> packet, uint32_t systemId)
+TelemetryStateRead()
 {
-    if (vcallbacks)
-        NS_LOG_INFO("A packet arrived at the gateway " << systemId << " under sensitivity."
-                                                       << " at " << Simulator::Now().GetSeconds());
-    auto it = packetTracker.find(packet);
-    if ((*it).first == packet)
+    if (!telemetryEnabled)
     {
-        (*it).second.outcomes.at(systemId - nDevices) = _UNDER_SENSITIVITY;
-        (*it).second.outcomeNumber += 1;
-        CheckReceptionByAllGWsComplete(it);
+        return;
     }
+    stepSample.step += 1;
+    stepSample.simTime = Simulator::Now().GetSeconds();
+    stepSample.simWall = GetWallTime(windowStart);
+    stepSample.events = Simulator::GetEventCount() - windowEvents;
+    stepSample.eventsPerSec = stepSample.simWall > 0 ? stepSample.events / stepSample.simWall : 0;
+    stepSample.trackerSize = packetTracker.GetSize();
+    stepSample.transmitted = numPackets;
+    stepSample.received = receivedPackets;
+    stepSample.rssBytes = StepTelemetry::GetRss();
+    stepSample.rewardWall = 0;
+    stepSample.ipcWall = 0;
+    stepSamplePending = true;
 }
 
+/**
+ * Writes the pending step sample, if any. Called when the actions of the step
+ * arrive, and for the last step (game over, end of the simulation), which no
+ * actions follow: its IPC time is then 0.
+ */
 void
-CourseChangeDetection(std::string context, Ptr<const MobilityModel> model)
+TelemetryFlush()
 {
-    Vector uav_position = model->GetPosition();
-    if (vcallbacks)
-        NS_LOG_INFO(context << " x = " << uav_position.x << ", y = " << uav_position.y
-                            << ", z = " << uav_position.z);
+    if (stepSamplePending && telemetry.IsOpen())
+    {
+        telemetry.Record(stepSample);
+    }
+    stepSamplePending = false;
 }
 
 /**
- * OPENGYM ENVIRONMENT FUNCTIONS
- * */
-
+ * Same step as OpenGymInterface::NotifyCurrentState, through the shared-memory
+ * channel: publishes the state, waits for the actions and executes them.
+ */
 void
-ScheduleNextStateRead()
+ScheduleNextShmStateRead()
 {
     if (vtime)
         NS_LOG_INFO("NowNSR: " << Simulator::Now().GetSeconds());
-    Simulator::Schedule(Seconds(700), &ScheduleNextStateRead);
-    openGym->NotifyCurrentState();
+    Simulator::Schedule(Seconds(700), &ScheduleNextShmStateRead);
+    TelemetryStateRead();
+    Ptr<OpenGymBoxContainer<uint32_t>> obs =
+        DynamicCast<OpenGymBoxContainer<uint32_t>>(GetObservation());
+    float reward = GetReward();
+    bool done = GetGameOver();
+    shmChannel.WriteState(obs->GetData(), reward, done, GetExtraInfo());
+
+    std::vector<uint32_t> actions;
+    if (!shmChannel.WaitActions(actions))
+    {
+        Simulator::Stop();
+        return;
+    }
+    if (jointActions)
+    {
+        std::vector<uint32_t> shape = {nGateways};
+        Ptr<OpenGymBoxContainer<uint32_t>> box = CreateObject<OpenGymBoxContainer<uint32_t>>(shape);
+        for (uint32_t a : actions)
+        {
+            box->AddValue(a);
+        }
+        ExecuteActions(box);
+    }
+    else
+    {
+        Ptr<OpenGymDiscreteContainer> discrete =
+            CreateObject<OpenGymDiscreteContainer>(env_action_space_size);
+        discrete->SetValue(actions.front());
+        ExecuteActions(discrete);
+    }
 }
 
 void
@@ -795,6 +1078,36 @@ ScheduleNextDataCollect()
     if (vtime)
         NS_LOG_INFO("NowNDC: " << Simulator::Now().GetSeconds());
     TrackersReset();
+    if (stepCached)
+    {
+        // Window already evaluated: report its counters instead of simulating it
+        numPackets = stepEntry.numPackets;
+        receivedPackets = stepEntry.receivedPackets;
+        lostPackets = stepEntry.lostPackets;
+        return;
+    }
+    if (analyticFidelity)
+    {
+        return;
+    }
+    if (stepRearm)
+    {
+        // Same first-packet spread as a fresh PeriodicSenderHelper::Install
+        for (auto a = applicationContainer.Begin(); a != applicationContainer.End(); ++a)
+        {
+            Ptr<PeriodicSender> sender = DynamicCast<PeriodicSender>(*a);
+            sender->SetInitialDelay(Seconds(appInitialDelay->GetValue(0, applicationInterval)));
+            sender->StartApplication();
+        }
+        Simulator::Schedule(Seconds(envStepTime), &StopDataCollect);
+        // Force ADR, only needed when a gateway changed its position
+        if (uavMoved)
+        {
+            SetSpreadingFactorsUp();
+            uavMoved = false;
+        }
+        return;
+    }
     PeriodicSenderHelper periodicSenderHelper;
     periodicSenderHelper.SetPeriod(Seconds(applicationInterval));
     periodicSenderHelper.SetPacketSize(packetSize);
@@ -802,15 +1115,26 @@ ScheduleNextDataCollect()
     forHelper.Install(gateways);
     applicationContainer = periodicSenderHelper.Install(endDevices);
     applicationContainer.Start(Seconds(0));
-    applicationContainer.Stop(Seconds(600));
+    applicationContainer.Stop(Seconds(envStepTime));
     // Force ADR
-    ns3::lorawan::LorawanMacHelper::SetSpreadingFactorsUp(endDevices, gateways, channel);
+    SetSpreadingFactorsUp();
+}
+
+void
+StopDataCollect()
+{
+    if (vtime)
+        NS_LOG_INFO("NowSDC: " << Simulator::Now().GetSeconds());
+    for (auto a = applicationContainer.Begin(); a != applicationContainer.End(); ++a)
+    {
+        DynamicCast<PeriodicSender>(*a)->StopApplication();
+    }
 }
 
 void
 TrackersReset()
 {
-    packetTracker.clear();
+    packetTracker.Clear();
     pkt_transmitted = 0;
     pkt_received = 0;
     pkt_interfered = 0;
@@ -819,9 +1143,308 @@ TrackersReset()
     numPackets = 0;
     lostPackets = 0;
     receivedPackets = 0;
+    deviceQos.assign(nDevices, DeviceQos());
+    servedDevices = 0;
     //    if (vtime) NS_LOG_INFO("Trackers Reseted!");
 }
 
+double
+QosToReward(double qos)
+{
+    return (isNaN(qos) || (qos < 0)) ? -1 : qos;
+}
+
+/**
+ * @return for each gateway, its column of the loss matrix, or nullptr when
+ * the gateway is off the lattice (or the matrix is disabled)
+ */
+std::vector<const float*>
+GetGatewayColumns()
+{
+    std::vector<const float*> columns(nGateways, nullptr);
+    if (useLossMatrix)
+    {
+        for (uint32_t g = 0; g < nGateways; ++g)
+        {
+            uint32_t cell =
+                lossMatrix.GetCell(gateways.Get(g)->GetObject<MobilityModel>()->GetPosition());
+            if (cell != PathLossMatrix::NOT_ON_GRID)
+            {
+                columns[g] = lossMatrix.GetColumn(cell);
+            }
+        }
+    }
+    return columns;
+}
+
+/**
+ * Finds the gateway with the highest received power from a device
+ * transmitting at 14 dBm.
+ * @param columns: as returned by GetGatewayColumns
+ * @param rxPower: received power at the best gateway (dBm)
+ * @return index of the best gateway
+ */
+uint32_t
+GetBestGateway(uint32_t device, const std::vector<const float*>& columns, double& rxPower)
+{
+    Ptr<MobilityModel> edMob;
+    uint32_t best = 0;
+    rxPower = -std::numeric_limits<double>::infinity();
+    for (uint32_t g = 0; g < nGateways; ++g)
+    {
+        double power;
+        if (columns[g])
+        {
+            power = columns[g][device];
+        }
+        else
+        {
+            if (!edMob)
+            {
+                edMob = endDevices.Get(device)->GetObject<MobilityModel>();
+            }
+            power = channel->GetRxPower(14, edMob, gateways.Get(g)->GetObject<MobilityModel>());
+        }
+        if (power > rxPower)
+        {
+            rxPower = power;
+            best = g;
+        }
+    }
+    return best;
+}
+
+/**
+ * @return SF given by LorawanMacHelper::SetSpreadingFactorsUp to this
+ * received power (SF12 when out of range)
+ */
+uint8_t
+GetSpreadingFactor(double rxPower)
+{
+    for (uint8_t i = 0; i < 6; ++i)
+    {
+        if (rxPower > spreadingFactorThreshold[i])
+        {
+            return 7 + i;
+        }
+    }
+    return 12;
+}
+
+/**
+ * Same assignment as LorawanMacHelper::SetSpreadingFactorsUp, with the
+ * received powers taken from the loss matrix.
+ */
+void
+SetSpreadingFactorsUp()
+{
+    std::vector<const float*> columns = GetGatewayColumns();
+    for (uint32_t d = 0; d < nDevices; ++d)
+    {
+        double rxPower;
+        GetBestGateway(d, columns, rxPower);
+        Ptr<LoraNetDevice> loraNetDevice =
+            endDevices.Get(d)->GetDevice(0)->GetObject<LoraNetDevice>();
+        Ptr<EndDeviceLorawanMac> mac = loraNetDevice->GetMac()->GetObject<EndDeviceLorawanMac>();
+        // Data rate 5 is SF7, data rate 0 is SF12
+        mac->SetDataRate(12 - GetSpreadingFactor(rxPower));
+    }
+}
+
+/**
+ * Time-on-air of the uplink frames for each SF, as sent by the end devices
+ * (125 kHz, CR 4/5, explicit header, CRC, low data rate optimization when the
+ * symbol time exceeds 16 ms)
+ */
+void
+ComputeOnAirTimes()
+{
+    Ptr<Packet> packet = Create<Packet>(packetSize + MAC_OVERHEAD);
+    LoraTxParameters txParams;
+    onAirTime.clear();
+    for (uint8_t sf = 7; sf <= 12; ++sf)
+    {
+        txParams.sf = sf;
+        txParams.headerDisabled = false;
+        txParams.codingRate = 1;
+        txParams.bandwidthHz = 125000;
+        txParams.nPreamble = 8;
+        txParams.crcEnabled = true;
+        txParams.lowDataRateOptimizationEnabled = LoraPhy::GetTSym(txParams) > MilliSeconds(16);
+        onAirTime.push_back(LoraPhy::GetOnAirTime(packet, txParams).GetSeconds());
+    }
+}
+
+/**
+ * Link-budget estimate of the QoS of a data collection window, computed
+ * without simulating its traffic.
+ * Each device is heard through the UAV with the highest received power and
+ * uses the SF that SetSpreadingFactorsUp would give it. The devices sharing
+ * UAV and SF collide as in pure ALOHA, and a device is served when at least
+ * one of its packets in the window gets through with a probability of at
+ * least servedProbability, the analytic counterpart of the simulated window,
+ * which serves a device once one of its packets arrives. As in
+ * PrintData, the delay is the time-on-air and any unserved device makes the
+ * window fail (-1).
+ */
+double
+AnalyticQos()
+{
+    std::vector<uint32_t> bestGateway(nDevices);
+    std::vector<uint8_t> sf(nDevices);
+    std::vector<uint32_t> load(nGateways * 6, 0);
+    std::vector<const float*> columns = GetGatewayColumns();
+    for (uint32_t d = 0; d < nDevices; ++d)
+    {
+        double rxPower;
+        bestGateway[d] = GetBestGateway(d, columns, rxPower);
+        if (rxPower < gatewaySensitivity[5])
+        {
+            if (vresults)
+                NS_LOG_UNCOND("There are unserved devices!");
+            return -1;
+        }
+        sf[d] = GetSpreadingFactor(rxPower);
+        load[bestGateway[d] * 6 + sf[d] - 7] += 1;
+    }
+
+    double packetsPerWindow = envStepTime / applicationInterval;
+    double sumQos = 0.0;
+    for (uint32_t d = 0; d < nDevices; ++d)
+    {
+        double toa = onAirTime[sf[d] - 7];
+        // Offered load of the other devices on the same UAV and SF
+        double interferers = load[bestGateway[d] * 6 + sf[d] - 7] - 1;
+        double success = std::exp(-2 * interferers * toa / applicationInterval);
+        if (1 - std::pow(1 - success, packetsPerWindow) < servedProbability)
+        {
+            if (vresults)
+                NS_LOG_UNCOND("There are unserved devices!");
+            return -1;
+        }
+        double dk = toa;
+        double rk = (packetSize + MAC_OVERHEAD) * 8 / dk;
+        sumQos += rk / MAX_RK + (1 - (dk / MIN_RK));
+    }
+    if (vresults)
+        NS_LOG_UNCOND("Analytic QoS: " << sumQos / nDevices);
+    return sumQos / nDevices;
+}
+
+/**
+ * Compares the analytic reward with the simulated one for the window that
+ * just ended, then moves the UAVs at random for the next window.
+ */
+void
+CalibrationStep()
+{
+    double simulated = QosToReward(PrintData());
+    double analytic = QosToReward(AnalyticQos());
+    std::cout << "calibration " << calibrationStep << " " << simulated << " " << analytic
+              << std::endl;
+    calibrationStep += 1;
+    if (calibrationStep == calibrationSteps)
+    {
+        Simulator::Stop();
+        return;
+    }
+    std::vector<uint32_t> actions(nGateways);
+    for (uint32_t i = 0; i < nGateways; ++i)
+    {
+        actions[i] = calibrationMoves->GetInteger(0, 4);
+    }
+    impossible_movement = false;
+    FindNewPositions(actions);
+    ScheduleNextDataCollect();
+    Simulator::Schedule(Seconds(700), &CalibrationStep);
+}
+
+/**
+ * Restarts the episode inside the running simulation: the UAVs return to their
+ * start positions, the step state is cleared and the application start times
+ * are drawn again from the beginning of their stream, as in a new process.
+ * The topology, the network server and the gym connection are kept.
+ */
+void
+ResetEpisode()
+{
+    episode += 1;
+    if (vgym)
+        NS_LOG_INFO("Episode reset: " << episode << " Time: " << Simulator::Now().GetSeconds());
+    for (uint32_t i = 0; i < nGateways; ++i)
+    {
+        Ptr<MobilityModel> gwMob = gateways.Get(i)->GetObject<MobilityModel>();
+        if (gwMob->GetPosition() != episodeStartPositions[i])
+        {
+            gwMob->SetPosition(episodeStartPositions[i]);
+            uavMoved = true;
+        }
+    }
+    UpdateOccupancy();
+    impossible_movement = false;
+    env_isGameOver = false;
+    env_action = 0;
+    m_qos = 0.0;
+    if (appInitialDelay)
+    {
+        appInitialDelay->SetStream(APP_DELAY_STREAM);
+    }
+}
+
+/**
+ * Key of the current UAV configuration: the sorted grid cells of the UAVs,
+ * so that the key does not depend on which UAV occupies which cell.
+ */
+std::string
+GetConfigurationKey()
+{
+    std::vector<std::pair<int64_t, int64_t>> cells;
+    for (auto g = gateways.Begin(); g != gateways.End(); ++g)
+    {
+        Vector position = (*g)->GetObject<MobilityModel>()->GetPosition();
+        cells.emplace_back(std::llround((position.x - latticeOrigin.x) / movementStep),
+                           std::llround((position.y - latticeOrigin.y) / movementStep));
+    }
+    std::sort(cells.begin(), cells.end());
+    std::ostringstream key;
+    key << rewardCachePrefix << latticeOrigin.x << "," << latticeOrigin.y << "o";
+    for (const auto& cell : cells)
+    {
+        key << ":" << cell.first << "," << cell.second;
+    }
+    return key.str();
+}
+
+/**
+ * Looks the configuration reached by the actions up in the reward cache,
+ * before its data collection window is scheduled.
+ */
+void
+LookupStep()
+{
+    stepCached = false;
+    if (!rewardCacheEnabled)
+    {
+        return;
+    }
+    stepKey = GetConfigurationKey();
+    stepCached = rewardCache.Lookup(stepKey, stepEntry);
+    if (vgym)
+        NS_LOG_INFO("Reward cache " << (stepCached ? "hit: " : "miss: ") << stepKey);
+}
+
+bool
+IsResetAction(Ptr<OpenGymDataContainer> action)
+{
+    Ptr<OpenGymDiscreteContainer> discrete = DynamicCast<OpenGymDiscreteContainer>(action);
+    if (discrete)
+    {
+        return discrete->GetValue() == RESET_ACTION;
+    }
+    Ptr<OpenGymBoxContainer<uint32_t>> box = DynamicCast<OpenGymBoxContainer<uint32_t>>(action);
+    return box && !box->GetData().empty() && box->GetData().front() == RESET_ACTION;
+}
+
 Ptr<OpenGymSpace>
 GetActionSpace()
 {
@@ -841,6 +1464,20 @@ GetActionSpace()
      * **/
     if (vgym)
         NS_LOG_FUNCTION("GetActionSpace");
+    if (jointActions)
+    {
+        /**
+         * Joint actions: one movement per UAV, in the UAV order
+         * (0: up, 1: down, 2: left, 3: right, 4: stay).
+         * Ex: [3, 4] = UAV 0 move right, UAV 1 stays
+         * **/
+        std::vector<uint32_t> shape = {nGateways};
+        std::string dtype = TypeNameGet<uint32_t>();
+        Ptr<OpenGymBoxSpace> box = CreateObject<OpenGymBoxSpace>(0, 4, shape, dtype);
+        if (vgym)
+            NS_LOG_INFO("GetActionSpace: " << box << " Time: " << Simulator::Now().GetSeconds());
+        return box;
+    }
     Ptr<OpenGymDiscreteSpace> space = CreateObject<OpenGymDiscreteSpace>(env_action_space_size);
     if (vgym)
         NS_LOG_INFO("GetActionSpace: " << space << " Time: " << Simulator::Now().GetSeconds());
@@ -858,11 +1495,25 @@ GetGameOver()
 float
 GetReward()
 {
+    auto start = std::chrono::steady_clock::now();
     if (env_action < env_action_space_size)
     {
-        m_qos = PrintData();
-        m_qos = (impossible_movement) ? -2 : ((isNaN(m_qos) || (m_qos < 0)) ? -1 : m_qos);
+        if (stepCached)
+        {
+            m_qos = stepEntry.qos;
+        }
+        else
+        {
+            m_qos = QosToReward(analyticFidelity ? AnalyticQos() : PrintData());
+            if (rewardCacheEnabled)
+            {
+                RewardCacheEntry entry = {m_qos, numPackets, receivedPackets, lostPackets};
+                rewardCache.Insert(stepKey, entry);
+            }
+        }
+        m_qos = (impossible_movement) ? -2 : m_qos;
     }
+    stepSample.rewardWall += GetWallTime(start);
     if (vgym)
         NS_LOG_INFO("MyGetReward: " << m_qos);
     return m_qos;
@@ -878,20 +1529,70 @@ GetExtraInfo()
     {
         env_info += "[impossible movement]";
     }
+    if (rewardCacheEnabled)
+    {
+        env_info += "[cache " + std::to_string(rewardCache.GetHits()) + ", " +
+                    std::to_string(rewardCache.GetMisses()) + "]";
+    }
+    if (telemetryEnabled && telemetryInfo)
+    {
+        // The IPC time of a step is only known once its actions arrive: report the previous one
+        StepSample sample = stepSample;
+        sample.ipcWall = lastIpcWall;
+        env_info += StepTelemetry::ToInfo(sample);
+    }
     if (vgym)
         NS_LOG_INFO("MyGetExtraInfo: " << env_info);
+    if (telemetryEnabled && env_isGameOver)
+    {
+        // No actions follow the last state
+        TelemetryFlush();
+    }
+    stateSent = std::chrono::steady_clock::now();
     return env_info;
 }
 
 bool
 ExecuteActions(Ptr<OpenGymDataContainer> action)
 {
+    if (telemetryEnabled)
+    {
+        if (stepSamplePending)
+        {
+            stepSample.ipcWall = GetWallTime(stateSent);
+            lastIpcWall = stepSample.ipcWall;
+        }
+        TelemetryFlush();
+        windowStart = std::chrono::steady_clock::now();
+        windowEvents = Simulator::GetEventCount();
+    }
+    if (IsResetAction(action))
+    {
+        ResetEpisode();
+        LookupStep();
+        ScheduleNextDataCollect();
+        return true;
+    }
+    if (jointActions)
+    {
+        Ptr<OpenGymBoxContainer<uint32_t>> box = DynamicCast<OpenGymBoxContainer<uint32_t>>(action);
+        std::vector<uint32_t> actions = box->GetData();
+        env_action = 0;
+        impossible_movement = false;
+        FindNewPositions(actions);
+        LookupStep();
+        ScheduleNextDataCollect();
+        if (vgym)
+            NS_LOG_INFO("MyExecuteAction: " << box << " Time: " << Simulator::Now().GetSeconds());
+        return true;
+    }
     Ptr<OpenGymDiscreteContainer> discrete = DynamicCast<OpenGymDiscreteContainer>(action);
     env_action = discrete->GetValue();
     uav_number = env_action / 4;
     env_action = env_action % 4;
     impossible_movement = false;
     FindNewPosition(env_action, uav_number);
+    LookupStep();
     ScheduleNextDataCollect();
     if (vgym)
         NS_LOG_INFO("MyExecuteAction: [" << uav_number << ", " << env_action
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Long-episode check of the step cost.
+
+Runs one episode of random actions with --telemetry and compares the means of the first
+and the last tenth of the steps, with the applications re-armed (--rearm=true, the
+default) or installed again on every step (--rearm=false). Run from the ns-3 root
+directory:
+    python3 scratch/lorawan-gym-V0.5/soak.py --steps 10000 [--rearm false]
+or summarize an existing telemetry file:
+    python3 scratch/lorawan-gym-V0.5/soak.py --csv soak.csv
+"""
+
+import argparse
+import csv
+import os
+
+__author__ = "Rogério S. Silva"
+__copyright__ = "Copyright (c) 2023, NumbERS - Federal Institute of Goiás, Inhumas - IFG"
+__version__ = "0.1.0"
+__email__ = "rogerio.sousa@ifg.edu.br"
+
+
+def run(steps, port, seed, devices, gateways, rearm, telemetry):
+    from ns3gym import ns3env
+
+    simArgs = {"--nDevices": devices,
+               "--nGateways": gateways,
+               "--rearm": rearm,
+               "--telemetry": telemetry}
+    env = ns3env.Ns3Env(port=port, startSim=1, simSeed=seed, simArgs=simArgs, debug=0)
+    try:
+        env.reset()
+        for step in range(steps):
+            env.step(env.action_space.sample())
+            if step % 1000 == 0:
+                print(f"step {step}")
+    finally:
+        env.close()
+
+
+def summarize(telemetry):
+    with open(telemetry) as f:
+        rows = list(csv.DictReader(f))
+    if len(rows) < 20:
+        raise SystemExit(f"{telemetry}: {len(rows)} steps, at least 20 are needed")
+    window = len(rows) // 10
+
+    def mean(part, column):
+        return sum(float(row[column]) for row in part) / len(part)
+
+    print(f"steps {len(rows)}, windows of {window} steps")
+    print("column first last last/first")
+    for column in ("rss_bytes", "events_per_sec", "sim_wall", "tracker_size"):
+        first = mean(rows[:window], column)
+        last = mean(rows[-window:], column)
+        ratio = last / first if first else float("nan")
+        print(f"{column} {first:.6g} {last:.6g} {ratio:.3f}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Step cost over a long episode")
+    parser.add_argument("--steps", type=int, default=10000)
+    parser.add_argument("--port", type=int, default=5555)
+    parser.add_argument("--seed", type=int, default=7)
+    parser.add_argument("--devices", type=int, default=10)
+    parser.add_argument("--gateways", type=int, default=2)
+    parser.add_argument("--rearm", default="true")
+    parser.add_argument("--csv", help="summarize this telemetry file instead of running")
+    args = parser.parse_args()
+
+    if args.csv:
+        summarize(args.csv)
+    else:
+        telemetry = os.path.abspath(f"soak-rearm-{args.rearm}.csv")
+        run(args.steps, args.port, args.seed, args.devices, args.gateways, args.rearm, telemetry)
+        summarize(telemetry)
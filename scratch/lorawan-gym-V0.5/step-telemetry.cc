@@ -0,0 +1,107 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+
+#include "step-telemetry.h"
+
+#include <sstream>
+#include <unistd.h>
+
+namespace ns3
+{
+
+StepTelemetry::StepTelemetry()
+    : m_json(false)
+{
+}
+
+bool
+StepTelemetry::Open(std::string filename)
+{
+    m_json = (filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0) ||
+             (filename.size() >= 6 && filename.compare(filename.size() - 6, 6, ".jsonl") == 0);
+    m_file.open(filename);
+    if (!m_file)
+    {
+        return false;
+    }
+    if (!m_json)
+    {
+        m_file << "step,sim_time,sim_wall,reward_wall,ipc_wall,events,events_per_sec,"
+                  "tracker_size,transmitted,received,rss_bytes"
+               << std::endl;
+    }
+    return true;
+}
+
+bool
+StepTelemetry::IsOpen() const
+{
+    return m_file.is_open();
+}
+
+void
+StepTelemetry::Record(const StepSample& sample)
+{
+    if (m_json)
+    {
+        m_file << "{\"step\": " << sample.step << ", \"sim_time\": " << sample.simTime
+               << ", \"sim_wall\": " << sample.simWall << ", \"reward_wall\": " << sample.rewardWall
+               << ", \"ipc_wall\": " << sample.ipcWall << ", \"events\": " << sample.events
+               << ", \"events_per_sec\": " << sample.eventsPerSec
+               << ", \"tracker_size\": " << sample.trackerSize
+               << ", \"transmitted\": " << sample.transmitted << ", \"received\": " << sample.received
+               << ", \"rss_bytes\": " << sample.rssBytes << "}\n";
+    }
+    else
+    {
+        m_file << sample.step << "," << sample.simTime << "," << sample.simWall << ","
+               << sample.rewardWall << "," << sample.ipcWall << "," << sample.events << ","
+               << sample.eventsPerSec << "," << sample.trackerSize << "," << sample.transmitted
+               << "," << sample.received << "," << sample.rssBytes << "\n";
+    }
+    // One line per step: keep the file readable while training
+    m_file.flush();
+}
+
+std::string
+StepTelemetry::ToInfo(const StepSample& sample)
+{
+    std::ostringstream info;
+    info << "[telemetry " << sample.simWall << ", " << sample.rewardWall << ", " << sample.ipcWall
+         << ", " << sample.events << ", " << sample.eventsPerSec << ", " << sample.trackerSize
+         << ", " << sample.rssBytes << "]";
+    return info.str();
+}
+
+uint64_t
+StepTelemetry::GetRss()
+{
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    if (!(statm >> size >> resident))
+    {
+        return 0;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+} // namespace ns3
@@ -0,0 +1,84 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef STEP_TELEMETRY_H
+#define STEP_TELEMETRY_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * Performance counters of one gym step. The wall times are in seconds.
+ */
+struct StepSample
+{
+    uint32_t step;
+    double simTime;       // simulation time at the state read (s)
+    double simWall;       // simulating the data collection window
+    double rewardWall;    // computing the reward
+    double ipcWall;       // from sending the state to receiving the actions
+    uint64_t events;      // simulator events executed in the window
+    double eventsPerSec;  // events / simWall
+    uint32_t trackerSize; // packets still missing an outcome (completed ones are retired)
+    int transmitted;
+    int received;
+    uint64_t rssBytes; // resident set size of the process
+};
+
+/**
+ * Writes one line per gym step, as CSV (with a header line) or as JSON lines
+ * when the file name ends with .json or .jsonl.
+ */
+class StepTelemetry
+{
+  public:
+    StepTelemetry();
+
+    /**
+     * @return false when the file cannot be created
+     */
+    bool Open(std::string filename);
+
+    bool IsOpen() const;
+
+    void Record(const StepSample& sample);
+
+    /**
+     * @return the sample as a compact "[telemetry ...]" string, for the step info
+     */
+    static std::string ToInfo(const StepSample& sample);
+
+    /**
+     * @return resident set size of this process, 0 when unavailable
+     */
+    static uint64_t GetRss();
+
+  private:
+    std::ofstream m_file;
+    bool m_json;
+};
+
+} // namespace ns3
+
+#endif /* STEP_TELEMETRY_H */
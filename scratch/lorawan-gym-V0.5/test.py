@@ -12,6 +12,7 @@ import random
 import matplotlib.pyplot as plt
 import numpy as np
 from ns3gym import ns3env
+from fast_reset import fast_reset
 from colorama import Fore, Back, Style
 
 __author__ = "Rogério S. Silva"
@@ -136,7 +137,7 @@ try:
             # print(f"State: {state}")
 
         rewards.append(sum_reward)
-        env.reset()
+        fast_reset(env)
 
         # Decrease epsilon
         epsilon = np.exp(-decay_rate * episode)
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Vectorized LoRaWAN environment: N independent ns-3 simulations (one sim.cc
+process each, ns-3 being a singleton per process) behind a single step() call.
+
+Every step sends the actions to all workers before waiting for any result, so
+the N simulation windows run in parallel instead of one ZMQ round trip after
+the other.
+
+Usage:
+    env = Ns3VecEnv(n_envs=4, base_port=5555, seeds=[1, 2, 3, 4], sim_args=simArgs)
+    obs = env.reset()
+    obs, rewards, dones, infos = env.step(env.sample_actions())
+"""
+
+import numpy as np
+from ns3gym import ns3env
+from fast_reset import reset_action
+
+__author__ = "Rogério S. Silva"
+__copyright__ = "Copyright (c) 2023, NumbERS - Federal Institute of Goiás, Inhumas - IFG"
+__version__ = "0.1.0"
+__email__ = "rogerio.sousa@ifg.edu.br"
+
+
+class Ns3VecEnv:
+    def __init__(self, n_envs, base_port=5555, seeds=None, sim_args=None, start_sim=True, debug=False):
+        """
+        :param n_envs: number of worker simulations
+        :param base_port: port of the first worker, the others use the following ports
+        :param seeds: simSeed of each worker (default: 1..n_envs)
+        :param sim_args: sim.cc arguments shared by all workers
+        """
+        if seeds is None:
+            seeds = list(range(1, n_envs + 1))
+        if len(seeds) != n_envs:
+            raise ValueError("One seed per environment is required")
+        self.n_envs = n_envs
+        # Workers are started one after the other: concurrent "./ns3 run" calls would race on the build
+        self.envs = [ns3env.Ns3Env(port=base_port + i, startSim=start_sim, simSeed=seeds[i],
+                                   simArgs=dict(sim_args or {}), debug=debug)
+                     for i in range(n_envs)]
+        self.observation_space = self.envs[0].observation_space
+        self.action_space = self.envs[0].action_space
+
+    def sample_actions(self):
+        return [env.action_space.sample() for env in self.envs]
+
+    def reset(self):
+        """
+        Restarts the episode of every worker in-process.
+        :return: batched first observations
+        """
+        self._exchange(range(self.n_envs), [reset_action(env) for env in self.envs])
+        for env in self.envs:
+            env.envDirty = False
+        return self._stack([env.ns3ZmqBridge.get_obs() for env in self.envs])
+
+    def get_state(self):
+        states = [env.get_state() for env in self.envs]
+        obs, rewards, dones, infos = zip(*states)
+        return self._stack(obs), np.array(rewards, dtype=np.float32), np.array(dones, dtype=bool), list(infos)
+
+    def step(self, actions):
+        """
+        Executes one action per worker. Workers that report game over are reset in-process,
+        and the returned observation of those workers is the first one of the new episode.
+        :return: batched observations, rewards, dones and the list of infos
+        """
+        if len(actions) != self.n_envs:
+            raise ValueError("One action per environment is required")
+        self._exchange(range(self.n_envs), actions)
+        for env in self.envs:
+            env.envDirty = True
+        obs, rewards, dones, infos = self.get_state()
+        finished = [i for i, done in enumerate(dones) if done]
+        if finished:
+            self._exchange(finished, [reset_action(self.envs[i]) for i in finished])
+            for i in finished:
+                self.envs[i].envDirty = False
+                obs[i] = np.asarray(self.envs[i].ns3ZmqBridge.get_obs())
+        return obs, rewards, dones, infos
+
+    def _exchange(self, indexes, actions):
+        # Fan out: every worker starts simulating its window...
+        for i, action in zip(indexes, actions):
+            self.envs[i].ns3ZmqBridge.send_actions(action)
+        # ... then gather the results
+        for i in indexes:
+            self.envs[i].ns3ZmqBridge.rx_env_state()
+
+    def close(self):
+        for env in self.envs:
+            env.close()
+
+    @staticmethod
+    def _stack(observations):
+        return np.stack([np.asarray(o) for o in observations])
@@ -37,6 +37,12 @@
 #include "ns3/forwarder-helper.h"
 #include "ns3/lorawan-module.h"
 #include "ns3/propagation-module.h"
+#include "fork-server.h"
+#include "gateway-batch.h"
+#include "gateway-outcome-recorder.h"
+#include "packet-log-writer.h"
+#include "placement-pack.h"
+#include "trace-policy.h"
 #include <algorithm>
 #include <ctime>
 #include <iomanip>
@@ -66,141 +72,49 @@ int underSensitivity = 0;
  *  Global Callbacks  *
  **********************/
 
-enum PacketOutcome { _RECEIVED, _INTERFERED, _NO_MORE_RECEIVERS, _UNDER_SENSITIVITY, _UNSET };
-
-struct myPacketStatus
-{
-  Ptr<Packet const> packet;
-  uint32_t senderId;
-  uint32_t receiverId;
-  Time sentTime;
-  Time receivedTime;
-  int outcomeNumber;
-  std::vector<enum PacketOutcome> outcomes;
-};
-
-std::map<Ptr<Packet const>, myPacketStatus> packetTracker;
+PacketStatusTracker packetTracker;
+std::vector<Ptr<GatewayOutcomeRecorder> > outcomeRecorders;
+PacketLogWriter packetLog;
+PlacementPack placementPack;
 
 void
-CheckReceptionByAllGWsComplete (std::map<Ptr<Packet const>, myPacketStatus>::iterator it)
+CheckReceptionByAllGWsComplete (uint32_t slot)
 {
-  // Check whether this packet is received by all gateways
-  if ((*it).second.outcomeNumber == nGat)
+  // Called once this packet has an outcome at every gateway: update the statistics
+  for (uint32_t j = 0; j < packetTracker.GetGateways (); j++)
     {
-      // Update the statistics
-      myPacketStatus status = (*it).second;
-      for (int j = 0; j < nGat; j++)
+      switch (packetTracker.GetOutcome (slot, j))
         {
-          switch (status.outcomes.at (j))
-            {
-              case _RECEIVED: {
-                received += 1;
-                break;
-              }
-              case _UNDER_SENSITIVITY: {
-                underSensitivity += 1;
-                break;
-              }
-              case _NO_MORE_RECEIVERS: {
-                noMoreReceivers += 1;
-                break;
-              }
-              case _INTERFERED: {
-                interfered += 1;
-                break;
-              }
-              case _UNSET: {
-                break;
-              }
-            }
+          case _RECEIVED: {
+            received += 1;
+            break;
+          }
+          case _UNDER_SENSITIVITY: {
+            underSensitivity += 1;
+            break;
+          }
+          case _NO_MORE_RECEIVERS: {
+            noMoreReceivers += 1;
+            break;
+          }
+          case _INTERFERED: {
+            interfered += 1;
+            break;
+          }
+          case _UNSET: {
+            break;
+          }
         }
-      // Remove the packet from the tracker
-      //      packetTracker.erase (it);
     }
+  packetLog.Write (packetTracker, slot);
+  packetTracker.Retire (slot);
 }
 
 void
 TransmissionCallback (Ptr<Packet const> packet, uint32_t systemId)
 {
-  NS_LOG_INFO ("Transmitted a packet from device " << systemId);
-  // Create a packetStatus
-  myPacketStatus status;
-  status.packet = packet;
-  status.senderId = systemId;
-  status.sentTime = Simulator::Now ();
-  status.outcomeNumber = 0;
-  status.outcomes = std::vector<enum PacketOutcome> (nGat, _UNSET);
-
-  packetTracker.insert (std::pair<Ptr<Packet const>, myPacketStatus> (packet, status));
-}
-
-void
-PacketReceptionCallback (Ptr<Packet const> packet, uint32_t systemId)
-{
-  // Remove the successfully received packet from the list of sent ones
-  NS_LOG_INFO ("A packet was successfully received at gateway " << systemId);
-
-  std::map<Ptr<Packet const>, myPacketStatus>::iterator it = packetTracker.find (packet);
-  if ((*it).second.outcomes.size () > systemId - nDevices)
-    {
-      //lembre que o ID do gateways é enumerado após todos os devices, logo numero sequencial
-      // do GW é contado subtraindo o nDevices. Ainda que os pacotes originados do mesmo device
-      // no mesmo instante é recebido pelos gateways na área de alcance,
-      // <e que essas duplicidades são removidas pela CheckReceptionByAllGWsComplete> sem certeza nisso
-      (*it).second.outcomes.at (systemId - nDevices) = _RECEIVED;
-      (*it).second.outcomeNumber += 1;
-//      if ((*it).second.outcomeNumber == 1 || (*it).second.receivedTime == Seconds (0))
-      if ((*it).second.receivedTime == Seconds (0))
-        {
-          (*it).second.receivedTime = Simulator::Now ();
-          (*it).second.receiverId = systemId;
-//          cc++;
-        }
-
-      CheckReceptionByAllGWsComplete (it);
-    }
-}
-
-void
-InterferenceCallback (Ptr<Packet const> packet, uint32_t systemId)
-{
-   NS_LOG_INFO ("A packet was lost because of interference at gateway " << systemId);
-
-  std::map<Ptr<Packet const>, myPacketStatus>::iterator it = packetTracker.find (packet);
-  if ((*it).second.outcomes.size () > systemId - nDevices)
-    {
-      (*it).second.outcomes.at (systemId - nDevices) = _INTERFERED;
-      (*it).second.outcomeNumber += 1;
-    }
-  CheckReceptionByAllGWsComplete (it);
-}
-
-void
-NoMoreReceiversCallback (Ptr<Packet const> packet, uint32_t systemId)
-{
-  NS_LOG_INFO ("A packet was lost because there were no more receivers at gateway " << systemId);
-
-  std::map<Ptr<Packet const>, myPacketStatus>::iterator it = packetTracker.find (packet);
-  if ((*it).second.outcomes.size () > systemId - nDevices)
-    {
-      (*it).second.outcomes.at (systemId - nDevices) = _NO_MORE_RECEIVERS;
-      (*it).second.outcomeNumber += 1;
-    }
-  CheckReceptionByAllGWsComplete (it);
-}
-
-void
-UnderSensitivityCallback (Ptr<Packet const> packet, uint32_t systemId)
-{
-  NS_LOG_INFO ("A packet arrived at the gateway under sensitivity" << systemId);
-
-  std::map<Ptr<Packet const>, myPacketStatus>::iterator it = packetTracker.find (packet);
-  if ((*it).second.outcomes.size () > systemId - nDevices)
-    {
-      (*it).second.outcomes.at (systemId - nDevices) = _UNDER_SENSITIVITY;
-      (*it).second.outcomeNumber += 1;
-    }
-  CheckReceptionByAllGWsComplete (it);
+  TRACE_INFO ("Transmitted a packet from device " << systemId);
+  GatewayOutcomeRecorder::RecordTransmission (packetTracker, packet, systemId);
 }
 
 uint8_t
@@ -217,25 +131,13 @@ SFToDR (uint8_t sf)
 void
 EndDevicesPlacement (std::string filename)
 {
-  double edX = 0.0, edY = 0.0, edZ = 0.0;
-  int nDev = 0;
-  Ptr<ListPositionAllocator> allocatorED = CreateObject<ListPositionAllocator> ();
-  const char *c = filename.c_str ();
-  // Get Devices position from File
-  std::ifstream in_File (c);
-  if (!in_File)
+  // From the placement pack when it holds this file
+  Ptr<ListPositionAllocator> allocatorED = placementPack.Load (filename);
+  int nDev = allocatorED->GetSize ();
+  if (nDev == 0)
     {
       std::cout << "Could not open the file - '" << filename << "'" << std::endl;
     }
-  else
-    {
-      while (in_File >> edX >> edY >> edZ)
-        {
-          allocatorED->Add (Vector (edX, edY, edZ));
-          nDev++;
-        }
-      in_File.close ();
-    }
 
   endDevices.Create (nDev);
   mobilityED.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
@@ -251,25 +153,13 @@ EndDevicesPlacement (std::string filename)
 int
 GatewaysPlacement (std::string filename)
 {
-  double gwX = 0.0, gwY = 0.0, gwZ = 0.0;
-  Ptr<ListPositionAllocator> allocatorGW = CreateObject<ListPositionAllocator> ();
-  const char *c = filename.c_str ();
-  // Get Devices position from File
-  std::ifstream in_File (c);
-  int nG = 0;
-  if (!in_File)
+  // From the placement pack when it holds this file
+  Ptr<ListPositionAllocator> allocatorGW = placementPack.Load (filename);
+  int nG = allocatorGW->GetSize ();
+  if (nG == 0)
     {
       std::cout << "Could not open the file - '" << filename << "'" << std::endl;
     }
-  else
-    {
-      while (in_File >> gwX >> gwY >> gwZ)
-        {
-          allocatorGW->Add (Vector (gwX, gwY, gwZ));
-          nG++;
-        }
-      in_File.close ();
-    }
   gateways.Create (nG);
   mobilityGW.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
   mobilityGW.SetPositionAllocator (allocatorGW);
@@ -311,6 +201,10 @@ main (int argc, char *argv[])
   int seed = 1;
   bool up = false;
   int packetSize = 41;
+  std::string placementPackFile = "";
+  std::string gatewayFiles = "";
+  std::string gatewaySets = "";
+  uint32_t forkJobs = 0;
 
   CommandLine cmd;
   cmd.AddValue ("nDevices", "Number of end devices to include in the simulation", nDevices);
@@ -320,8 +214,27 @@ main (int argc, char *argv[])
   cmd.AddValue ("printRates", "Whether to print result rates", printRates);
   cmd.AddValue ("seed", "Independent replications seed", seed);
   cmd.AddValue ("up", "Spread Factor UP", up);
+  cmd.AddValue ("placementPack", "Placement pack read instead of the placement files it holds",
+                placementPackFile);
+  cmd.AddValue ("gatewayFiles",
+                "Batch mode: comma-separated gateway placement files, each scored in its own "
+                "window against the same devices",
+                gatewayFiles);
+  cmd.AddValue ("gatewaySets",
+                "Fork server: comma-separated numbers of gateways, one child run per number "
+                "sharing the devices built by the parent",
+                gatewaySets);
+  cmd.AddValue ("forkJobs", "Fork server: children running at a time, 0 for the number of CPUs",
+                forkJobs);
   cmd.Parse (argc, argv);
 
+  if (!placementPackFile.empty () && !placementPack.Open (placementPackFile))
+    {
+      NS_FATAL_ERROR ("Could not open the placement pack " << placementPackFile);
+    }
+  GatewayBatch batch;
+  batch.Load (gatewayFiles, placementPack);
+
   RngSeedManager::SetSeed (seed + 100);
 
   Config::SetDefault ("ns3::EndDeviceLorawanMac::DRControl", BooleanValue (false));
@@ -413,6 +326,39 @@ main (int argc, char *argv[])
   macHelper.SetRegion (LorawanMacHelper::EU);
   helper.Install (phyHelper, macHelper, endDevices);
 
+  // Connect trace sources
+  for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j)
+    {
+      Ptr<Node> node = *j;
+      Ptr<LoraNetDevice> loraNetDevice = node->GetDevice (0)->GetObject<LoraNetDevice> ();
+      Ptr<LoraPhy> phy = loraNetDevice->GetPhy ();
+      phy->TraceConnectWithoutContext ("StartSending", MakeCallback (&TransmissionCallback));
+    }
+
+  /*******************************************
+  *  Fork server: one child per gateway set  *
+  *******************************************/
+
+  // The devices above are built once and shared copy-on-write by the children,
+  // each child goes on from here as a standalone run with its own nGateways
+  ForkServer forkServer (forkJobs);
+  std::vector<uint32_t> gatewaySetList = ForkServer::ParseList (gatewaySets);
+  if (!gatewaySetList.empty ())
+    {
+      int32_t replication = forkServer.Serve (gatewaySetList.size ());
+      if (replication == ForkServer::PARENT)
+        {
+          for (uint32_t i = 0; i < gatewaySetList.size (); ++i)
+            {
+              std::cout << gatewaySetList[i] << "x" << nDevices << " " << forkServer.GetResult (i)
+                        << (forkServer.GetStatus (i) == 0 ? "" : " (failed)") << std::endl;
+            }
+          Simulator::Destroy ();
+          return 0;
+        }
+      nGateways = gatewaySetList[replication];
+    }
+
   // Configuring devices
   Ptr<LoraPhy> phyED;
   Ptr<ClassAEndDeviceLorawanMac> macED;
@@ -435,15 +381,6 @@ main (int argc, char *argv[])
     }
   in_File.close ();
 
-  // Connect trace sources
-  for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j)
-    {
-      Ptr<Node> node = *j;
-      Ptr<LoraNetDevice> loraNetDevice = node->GetDevice (0)->GetObject<LoraNetDevice> ();
-      Ptr<LoraPhy> phy = loraNetDevice->GetPhy ();
-      phy->TraceConnectWithoutContext ("StartSending", MakeCallback (&TransmissionCallback));
-    }
-
   /*********************
   *  Create Gateways  *
   *********************/
@@ -455,28 +392,25 @@ main (int argc, char *argv[])
                          std::to_string (seed) + "s_" + std::to_string (nGateways) + "x1Gv_" +
                          std::to_string (nDevices) + "D.dat";
 
-  nGat = GatewaysPlacement (filename);
+  if (batch.GetSize () > 0)
+    {
+      batch.Create (gateways);
+      nGat = gateways.GetN ();
+    }
+  else
+    {
+      nGat = GatewaysPlacement (filename);
+    }
 
   // Create a net device for each gateway
   phyHelper.SetDeviceType (LoraPhyHelper::GW);
   macHelper.SetDeviceType (LorawanMacHelper::GW);
   helper.Install (phyHelper, macHelper, gateways);
 
-  for (NodeContainer::Iterator g = gateways.Begin (); g != gateways.End (); ++g)
-    {
-      Ptr<Node> object = *g;
-      // Get the device
-      Ptr<NetDevice> netDevice = object->GetDevice (0);
-      Ptr<LoraNetDevice> loraNetDevice = netDevice->GetObject<LoraNetDevice> ();
-      Ptr<GatewayLoraPhy> gwPhy = loraNetDevice->GetPhy ()->GetObject<GatewayLoraPhy> ();
-      gwPhy->TraceConnectWithoutContext ("ReceivedPacket", MakeCallback (&PacketReceptionCallback));
-      gwPhy->TraceConnectWithoutContext ("LostPacketBecauseInterference",
-                                         MakeCallback (&InterferenceCallback));
-      gwPhy->TraceConnectWithoutContext ("LostPacketBecauseNoMoreReceivers",
-                                         MakeCallback (&NoMoreReceiversCallback));
-      gwPhy->TraceConnectWithoutContext ("LostPacketBecauseUnderSensitivity",
-                                         MakeCallback (&UnderSensitivityCallback));
-    }
+  // One outcome recorder per gateway, replacing the four trace callbacks
+  outcomeRecorders = GatewayOutcomeRecorder::Install (
+      gateways, packetTracker, MakeNullCallback<void, uint32_t> (),
+      MakeCallback (&CheckReceptionByAllGWsComplete));
 
   NS_LOG_DEBUG ("Completed configuration");
 
@@ -523,13 +457,40 @@ main (int argc, char *argv[])
   *  Simulation  *
   ****************/
 
+  if (batch.GetSize () > 0)
+    {
+      // Batch mode: one result row per candidate gateway set instead of the run outputs
+      std::function<void ()> prepare;
+      if (up)
+        {
+          prepare = [&] () { macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel); };
+        }
+      batch.Run (gateways, appContainer, packetTracker, appStopTime, Minutes (10), prepare,
+                 std::cout);
+      Simulator::Destroy ();
+      return 0;
+    }
+
   Simulator::Stop (appStopTime + Minutes (10));
 
+  std::string path_output = "/home/rogerio/git/sim-res/datafile/"
+                            "optimized-oriented/results/qos_b0.9/";
+
+  if (printRates)
+    {
+      // Binary packet log, written as packets complete (see packet_log.py)
+      std::string packs_filename = path_output + "packets/transmissionPackets_" +
+                                   std::to_string (seed) + "_" + std::to_string (nGat) + "x" +
+                                   std::to_string (nDevices) + ".bin";
+      if (!packetLog.Open (packs_filename, gateways.GetN ()))
+        {
+          NS_FATAL_ERROR ("Could not create the packet log " << packs_filename);
+        }
+    }
+
   Simulator::Run ();
   NS_LOG_INFO ("Computing performance metrics...");
 
-  std::string path_output = "/home/rogerio/git/sim-res/datafile/"
-                            "optimized-oriented/results/qos_b0.9/";
   if (printRates)
     {
 
@@ -542,31 +503,15 @@ main (int argc, char *argv[])
       PrintEndDevicesParameters (par_filename);
 
       /**
-         * Print PACKETS
-         * **/
-
-      std::string packs_filename = path_output + "packets/transmissionPackets_" +
-                                   std::to_string (seed) + "_" + std::to_string (nGat) + "x" +
-                                   std::to_string (nDevices) + ".dat";
-      const char *cPK = packs_filename.c_str ();
-      std::ofstream filePKT;
-      filePKT.open (cPK, std::ios::out);
-      for (std::map<Ptr<Packet const>, myPacketStatus>::iterator p = packetTracker.begin ();
-           p != packetTracker.end (); ++p)
+       * Print PACKETS
+       * **/
+      // Complete packets were logged and retired during the run, the ones left
+      // were not reported by every gateway
+      for (uint32_t slot = 0; slot < packetTracker.GetSize (); ++slot)
         {
-          filePKT << (*p).second.senderId << " " << (*p).second.receiverId << " "
-                  << (*p).second.sentTime.GetSeconds () << " "
-                  << (*p).second.receivedTime.GetSeconds () << " "
-                  << (*p).second.receivedTime.GetSeconds () - (*p).second.sentTime.GetSeconds ()
-                  << std::endl;
-
-          std::cout << (*p).second.senderId << " " << (*p).second.receiverId << " "
-                  << (*p).second.sentTime.GetSeconds () << " "
-                  << (*p).second.receivedTime.GetSeconds () << " "
-                  << (*p).second.receivedTime.GetSeconds () - (*p).second.sentTime.GetSeconds ()
-                  << std::endl;
+          packetLog.Write (packetTracker, slot);
         }
-      filePKT.close ();
+      packetLog.Close ();
     }
 
   Simulator::Destroy ();
@@ -621,5 +566,12 @@ main (int argc, char *argv[])
     }
 //  std::cout << cc << std::endl;
 //  std::cout << packetTracker.size();
+  if (forkServer.IsChild ())
+    {
+      forkServer.Reply ("received " + std::to_string (received) + " interfered " +
+                        std::to_string (interfered) + " noMoreReceivers " +
+                        std::to_string (noMoreReceivers) + " underSensitivity " +
+                        std::to_string (underSensitivity));
+    }
   return 0;
 }
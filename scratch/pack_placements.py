@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Packs "x y z" placement files into one placement pack, read by PlacementPack (placement-pack.h).
+
+Each file is stored under its base name, the name the simulations look up. Directories are searched
+recursively for *Placement*.dat files:
+    python3 pack_placements.py placements.pack lorawan-gym-V0.5/data/ed lorawan-gym-V0.5/data/gw
+    ./ns3 run "scratch/lorawan-gym-V0.5/sim --placementPack=placements.pack"
+
+List the content of a pack:
+    python3 pack_placements.py --list placements.pack
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+__author__ = "Rogério S. Silva"
+__copyright__ = "Copyright (c) 2023, NumbERS - Federal Institute of Goiás, Inhumas - IFG"
+__version__ = "0.1.0"
+__email__ = "rogerio.sousa@ifg.edu.br"
+
+MAGIC = 0x4b415050
+VERSION = 1
+NAME_SIZE = 112
+HEADER = struct.Struct("<IIIIQQ")
+ENTRY = struct.Struct("<%dsQII" % NAME_SIZE)
+
+
+def read_placement(filename):
+    """
+    :return: the coordinates of the file, as the simulations parse it (whitespace separated, 3 per node)
+    """
+    values = []
+    with open(filename) as f:
+        for token in f.read().split():
+            try:
+                values.append(float(token))
+            except ValueError:
+                break
+    return values[:len(values) - len(values) % 3]
+
+
+def collect(paths):
+    files = {}
+    for path in paths:
+        if os.path.isdir(path):
+            found = [os.path.join(root, name) for root, _, names in os.walk(path)
+                     for name in names if "Placement" in name and name.endswith(".dat")]
+        else:
+            found = [path]
+        for filename in found:
+            name = os.path.basename(filename)
+            if name in files and files[name] != filename:
+                sys.exit("%s and %s have the same base name" % (files[name], filename))
+            if len(name.encode()) >= NAME_SIZE:
+                sys.exit("%s: name longer than %d bytes" % (filename, NAME_SIZE - 1))
+            files[name] = filename
+    return files
+
+
+def pack(output, paths):
+    files = collect(paths)
+    names = sorted(files, key=lambda n: n.encode())
+    with open(output, "wb") as out:
+        out.write(b"\0" * HEADER.size)
+        entries = []
+        for name in names:
+            values = read_placement(files[name])
+            entries.append((name, out.tell(), len(values) // 3))
+            out.write(struct.pack("<%dd" % len(values), *values))
+        index_offset = out.tell()
+        for name, offset, count in entries:
+            out.write(ENTRY.pack(name.encode(), offset, count, 0))
+        out.seek(0)
+        out.write(HEADER.pack(MAGIC, VERSION, len(entries), 0, index_offset, 0))
+    print("%d placements packed into %s" % (len(entries), output))
+
+
+def list_pack(filename):
+    with open(filename, "rb") as f:
+        data = f.read()
+    magic, version, entries, _, index_offset, _ = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        sys.exit("%s is not a version %d placement pack" % (filename, VERSION))
+    for i in range(entries):
+        name, offset, count, _ = ENTRY.unpack_from(data, index_offset + i * ENTRY.size)
+        print("%s %d" % (name.rstrip(b"\0").decode(), count))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Packs placement files into one mappable file")
+    parser.add_argument("--list", action="store_true", help="list the placements of a pack")
+    parser.add_argument("pack", help="pack file")
+    parser.add_argument("paths", nargs="*", help="placement files or directories")
+    args = parser.parse_args()
+    if args.list:
+        list_pack(args.pack)
+    elif args.paths:
+        pack(args.pack, args.paths)
+    else:
+        parser.error("no placement files given")
+
+
+if __name__ == "__main__":
+    main()
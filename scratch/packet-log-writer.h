@@ -0,0 +1,188 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef PACKET_LOG_WRITER_H
+#define PACKET_LOG_WRITER_H
+
+#include "packet-status-tracker.h"
+
+#include "ns3/fatal-error.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Binary packet log, read back by packet_log.py.
+ *
+ * The file starts with a 16-byte header (magic "PLOG", version, number of
+ * gateways, record size) followed by fixed-size little-endian records:
+ *
+ *   offset  type        field
+ *   0       uint32      senderId
+ *   4       uint32      receiverId
+ *   8       double      sentTime (s)
+ *   16      double      receivedTime (s), 0 when no gateway received it
+ *   24      uint8       senderSF
+ *   25      uint8       receiverSF
+ *   26      uint16      outcomeNumber
+ *   28      uint32      size (bytes)
+ *   32      uint64[w]   outcomes, 4 bits per gateway as in PacketStatusTracker
+ *
+ * Records are packed into a large buffer and written with one fwrite per
+ * buffer, so logging a packet costs a memcpy instead of a flushed line. A
+ * short write (full disk, I/O error) is fatal rather than leaving a
+ * truncated log.
+ */
+class PacketLogWriter
+{
+  public:
+    static constexpr uint32_t MAGIC = 0x474f4c50; // "PLOG"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t HEADER_SIZE = 16;
+    static constexpr uint32_t FIXED_SIZE = 32;
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    PacketLogWriter() = default;
+    PacketLogWriter(const PacketLogWriter&) = delete;
+    PacketLogWriter& operator=(const PacketLogWriter&) = delete;
+
+    ~PacketLogWriter()
+    {
+        Close();
+    }
+
+    /**
+     * Creates the log file and writes its header.
+     * @param nGateways: number of gateways of the tracker whose records are logged
+     * @return false when the file cannot be created
+     */
+    bool Open(const std::string& filename, uint32_t nGateways)
+    {
+        Close();
+        m_filename = filename;
+        m_file = std::fopen(filename.c_str(), "wb");
+        if (m_file == nullptr)
+        {
+            return false;
+        }
+        // The records are already batched here
+        std::setvbuf(m_file, nullptr, _IONBF, 0);
+        m_words = (nGateways + 15) / 16;
+        m_recordSize = FIXED_SIZE + 8 * m_words;
+        m_buffer.resize(BUFFER_SIZE - BUFFER_SIZE % m_recordSize);
+        m_used = 0;
+        m_count = 0;
+        uint32_t header[4] = {MAGIC, VERSION, nGateways, m_recordSize};
+        std::memcpy(m_buffer.data(), header, HEADER_SIZE);
+        m_used = HEADER_SIZE;
+        return true;
+    }
+
+    bool IsOpen() const
+    {
+        return m_file != nullptr;
+    }
+
+    /**
+     * Appends the record of a tracker slot. Does nothing when the log is closed.
+     */
+    void Write(const PacketStatusTracker& tracker, uint32_t slot)
+    {
+        if (m_file == nullptr)
+        {
+            return;
+        }
+        if (m_used + m_recordSize > m_buffer.size())
+        {
+            Flush();
+        }
+        const PacketRecord& p = tracker.Get(slot);
+        char* r = m_buffer.data() + m_used;
+        double sentTime = p.sentTime.GetSeconds();
+        double receivedTime = p.receivedTime.GetSeconds();
+        uint16_t outcomeNumber = p.outcomeNumber;
+        std::memcpy(r, &p.senderId, 4);
+        std::memcpy(r + 4, &p.receiverId, 4);
+        std::memcpy(r + 8, &sentTime, 8);
+        std::memcpy(r + 16, &receivedTime, 8);
+        r[24] = p.senderSF;
+        r[25] = p.receiverSF;
+        std::memcpy(r + 26, &outcomeNumber, 2);
+        std::memcpy(r + 28, &p.size, 4);
+        uint32_t words = tracker.GetOutcomeWords() < m_words ? tracker.GetOutcomeWords() : m_words;
+        std::memset(r + FIXED_SIZE, 0x44, 8 * m_words); // _UNSET
+        std::memcpy(r + FIXED_SIZE, tracker.GetOutcomes(slot), 8 * words);
+        m_used += m_recordSize;
+        m_count++;
+    }
+
+    /**
+     * Writes the buffered records and closes the file.
+     */
+    void Close()
+    {
+        if (m_file != nullptr)
+        {
+            Flush();
+            int status = std::fclose(m_file);
+            m_file = nullptr;
+            if (status != 0)
+            {
+                NS_FATAL_ERROR("Could not close the packet log " << m_filename);
+            }
+        }
+    }
+
+    /**
+     * @return number of records written since Open
+     */
+    uint64_t GetCount() const
+    {
+        return m_count;
+    }
+
+  private:
+    void Flush()
+    {
+        if (std::fwrite(m_buffer.data(), 1, m_used, m_file) != m_used)
+        {
+            NS_FATAL_ERROR("Could not write the packet log " << m_filename);
+        }
+        m_used = 0;
+    }
+
+    std::string m_filename;
+    std::FILE* m_file = nullptr;
+    std::vector<char> m_buffer;
+    size_t m_used = 0;
+    uint32_t m_words = 0;
+    uint32_t m_recordSize = FIXED_SIZE;
+    uint64_t m_count = 0;
+};
+
+} // namespace ns3
+
+#endif /* PACKET_LOG_WRITER_H */
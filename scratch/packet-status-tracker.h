@@ -0,0 +1,418 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef PACKET_STATUS_TRACKER_H
+#define PACKET_STATUS_TRACKER_H
+
+#include "ns3/nstime.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+enum PacketOutcome : uint8_t
+{
+    _RECEIVED,
+    _INTERFERED,
+    _NO_MORE_RECEIVERS,
+    _UNDER_SENSITIVITY,
+    _UNSET
+};
+
+/**
+ * Status of a transmitted packet. The per-gateway outcomes are kept by the
+ * tracker, next to the record, and are reached through the record slot.
+ */
+struct PacketRecord
+{
+    uint64_t uid;
+    uint32_t senderId;
+    uint32_t receiverId;
+    uint32_t size; // bytes
+    Time sentTime;
+    Time receivedTime;
+    uint8_t senderSF;
+    uint8_t receiverSF;
+    double senderTP;
+    double receiverTP;
+    uint32_t outcomeNumber;
+};
+
+/**
+ * Totals of the packets retired from the tracker, per sender device
+ */
+struct DeviceAggregate
+{
+    uint32_t retired;
+    uint32_t received; // by at least one gateway
+    double delaySum;   // s, over the received packets
+};
+
+/**
+ * Totals of the packets retired from the tracker, per gateway and outcome
+ */
+struct GatewayAggregate
+{
+    uint32_t outcomes[_UNSET];
+};
+
+/**
+ * Packet tracker keyed by packet UID.
+ *
+ * Records live in a dense slot arena (in transmission order until a record
+ * is erased) and are located through an open-addressing index with linear
+ * probing. The gateway outcomes of each packet are packed four bits per
+ * gateway into a fixed number of 64-bit words per slot, so tracking a packet
+ * does not allocate once the arena has grown to the working set.
+ *
+ * The UID is preserved by Packet::Copy (), hence the copies delivered by the
+ * channel to every gateway resolve to the record created at transmission.
+ *
+ * Once every gateway has reported, a packet can be retired: its outcomes are
+ * added to per-device and per-gateway aggregates and its slot is freed, so
+ * the tracker only holds the packets still in flight.
+ */
+class PacketStatusTracker
+{
+  public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    PacketStatusTracker()
+    {
+        SetGateways(0);
+    }
+
+    /**
+     * Sets the number of gateways and clears the tracker.
+     * @param nGateways: number of outcomes stored per packet
+     */
+    void SetGateways(uint32_t nGateways)
+    {
+        m_nGateways = nGateways;
+        m_gatewayAggregates.resize(nGateways);
+        m_wordsPerSlot = (nGateways + OUTCOMES_PER_WORD - 1) / OUTCOMES_PER_WORD;
+        if (m_index.empty())
+        {
+            Rehash(MIN_CAPACITY);
+        }
+        Clear();
+    }
+
+    uint32_t GetGateways() const
+    {
+        return m_nGateways;
+    }
+
+    /**
+     * Creates the record of a packet. The record is zeroed and all of its
+     * gateway outcomes are _UNSET. A UID already tracked (the same packet
+     * sent again) gets its record reset in place, so no record is orphaned.
+     * @param uid: packet UID
+     * @return slot of the record
+     */
+    uint32_t Insert(uint64_t uid)
+    {
+        uint32_t slot = Find(uid);
+        if (slot != NOT_FOUND)
+        {
+            m_records[slot] = PacketRecord();
+            m_records[slot].uid = uid;
+            std::fill(m_outcomes.begin() + uint64_t(slot) * m_wordsPerSlot,
+                      m_outcomes.begin() + uint64_t(slot + 1) * m_wordsPerSlot,
+                      UNSET_WORD);
+            return slot;
+        }
+        if (2 * (m_records.size() + 1) > m_index.size())
+        {
+            Rehash(2 * m_index.size());
+        }
+        slot = m_records.size();
+        m_records.push_back(PacketRecord()); // value-initialized, i.e. zeroed
+        m_records.back().uid = uid;
+        m_outcomes.resize(m_outcomes.size() + m_wordsPerSlot, UNSET_WORD);
+
+        size_t i = Hash(uid);
+        while (m_index[i].slot != EMPTY)
+        {
+            i = (i + 1) & m_mask;
+        }
+        m_index[i].uid = uid;
+        m_index[i].slot = slot;
+        return slot;
+    }
+
+    /**
+     * @param uid: packet UID
+     * @return slot of the packet record or NOT_FOUND
+     */
+    uint32_t Find(uint64_t uid) const
+    {
+        size_t i = Hash(uid);
+        while (m_index[i].slot != EMPTY)
+        {
+            if (m_index[i].uid == uid)
+            {
+                return m_index[i].slot;
+            }
+            i = (i + 1) & m_mask;
+        }
+        return NOT_FOUND;
+    }
+
+    PacketRecord& Get(uint32_t slot)
+    {
+        return m_records[slot];
+    }
+
+    const PacketRecord& Get(uint32_t slot) const
+    {
+        return m_records[slot];
+    }
+
+    PacketOutcome GetOutcome(uint32_t slot, uint32_t gw) const
+    {
+        uint64_t word = m_outcomes[slot * m_wordsPerSlot + gw / OUTCOMES_PER_WORD];
+        return PacketOutcome((word >> Shift(gw)) & OUTCOME_MASK);
+    }
+
+    /**
+     * @return the packed outcomes of a slot, GetOutcomeWords () words of
+     * sixteen 4-bit outcomes, gateway 0 in the low bits of the first word
+     */
+    const uint64_t* GetOutcomes(uint32_t slot) const
+    {
+        return m_outcomes.data() + size_t(slot) * m_wordsPerSlot;
+    }
+
+    uint32_t GetOutcomeWords() const
+    {
+        return m_wordsPerSlot;
+    }
+
+    /**
+     * Stores the outcome of a packet at a gateway and counts it when the
+     * gateway had no outcome yet.
+     * @return the number of gateways with an outcome for this packet
+     */
+    uint32_t SetOutcome(uint32_t slot, uint32_t gw, PacketOutcome outcome)
+    {
+        uint64_t& word = m_outcomes[slot * m_wordsPerSlot + gw / OUTCOMES_PER_WORD];
+        if (((word >> Shift(gw)) & OUTCOME_MASK) == _UNSET)
+        {
+            m_records[slot].outcomeNumber += 1;
+        }
+        word = (word & ~(OUTCOME_MASK << Shift(gw))) | (uint64_t(outcome) << Shift(gw));
+        return m_records[slot].outcomeNumber;
+    }
+
+    /**
+     * Removes a record. The last record is moved into the freed slot, so the
+     * slots of the other records stay valid except for that one.
+     */
+    void Erase(uint32_t slot)
+    {
+        Unindex(m_records[slot].uid);
+        uint32_t last = m_records.size() - 1;
+        if (slot != last)
+        {
+            m_records[slot] = m_records[last];
+            std::copy_n(m_outcomes.begin() + size_t(last) * m_wordsPerSlot,
+                        m_wordsPerSlot,
+                        m_outcomes.begin() + size_t(slot) * m_wordsPerSlot);
+            size_t i = Hash(m_records[slot].uid);
+            while (m_index[i].slot == EMPTY || m_index[i].uid != m_records[slot].uid)
+            {
+                i = (i + 1) & m_mask;
+            }
+            m_index[i].slot = slot;
+        }
+        m_records.pop_back();
+        m_outcomes.resize(m_outcomes.size() - m_wordsPerSlot);
+    }
+
+    /**
+     * Adds the outcomes of a packet to the aggregates and erases its record.
+     */
+    void Retire(uint32_t slot)
+    {
+        const PacketRecord& record = m_records[slot];
+        if (record.senderId >= m_deviceAggregates.size())
+        {
+            m_deviceAggregates.resize(record.senderId + 1, DeviceAggregate());
+        }
+        DeviceAggregate& device = m_deviceAggregates[record.senderId];
+        device.retired += 1;
+        bool received = false;
+        for (uint32_t gw = 0; gw < m_nGateways; ++gw)
+        {
+            PacketOutcome outcome = GetOutcome(slot, gw);
+            if (outcome != _UNSET)
+            {
+                m_gatewayAggregates[gw].outcomes[outcome] += 1;
+            }
+            received = received || outcome == _RECEIVED;
+        }
+        if (received)
+        {
+            device.received += 1;
+            device.delaySum += (record.receivedTime - record.sentTime).GetSeconds();
+        }
+        Erase(slot);
+    }
+
+    /**
+     * @return aggregates of the retired packets, indexed by sender id
+     */
+    const std::vector<DeviceAggregate>& GetDeviceAggregates() const
+    {
+        return m_deviceAggregates;
+    }
+
+    /**
+     * @return aggregates of the retired packets, indexed by gateway
+     */
+    const std::vector<GatewayAggregate>& GetGatewayAggregates() const
+    {
+        return m_gatewayAggregates;
+    }
+
+    /**
+     * Removes every record and resets the aggregates, keeping the allocated memory.
+     */
+    void Clear()
+    {
+        m_records.clear();
+        m_outcomes.clear();
+        for (auto& bucket : m_index)
+        {
+            bucket.slot = EMPTY;
+        }
+        std::fill(m_deviceAggregates.begin(), m_deviceAggregates.end(), DeviceAggregate());
+        std::fill(m_gatewayAggregates.begin(), m_gatewayAggregates.end(), GatewayAggregate());
+    }
+
+    uint32_t GetSize() const
+    {
+        return m_records.size();
+    }
+
+    std::vector<PacketRecord>::const_iterator begin() const
+    {
+        return m_records.begin();
+    }
+
+    std::vector<PacketRecord>::const_iterator end() const
+    {
+        return m_records.end();
+    }
+
+  private:
+    struct Bucket
+    {
+        uint64_t uid;
+        uint32_t slot;
+    };
+
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+    static constexpr uint32_t MIN_CAPACITY = 1024;
+    static constexpr uint32_t OUTCOME_BITS = 4;
+    static constexpr uint32_t OUTCOMES_PER_WORD = 64 / OUTCOME_BITS;
+    static constexpr uint64_t OUTCOME_MASK = (uint64_t(1) << OUTCOME_BITS) - 1;
+    // Every nibble set to _UNSET
+    static constexpr uint64_t UNSET_WORD = 0x4444444444444444ULL;
+    static_assert(_UNSET == 4, "UNSET_WORD must match the _UNSET nibble");
+
+    static uint32_t Shift(uint32_t gw)
+    {
+        return (gw % OUTCOMES_PER_WORD) * OUTCOME_BITS;
+    }
+
+    size_t Hash(uint64_t uid) const
+    {
+        // Packet UIDs come from a global counter: indexing by their low bits
+        // keeps packets sent close in time in neighbouring buckets
+        return size_t(uid) & m_mask;
+    }
+
+    /**
+     * Removes a UID from the index, shifting back the entries of its probe
+     * sequence so that no tombstone is left.
+     */
+    void Unindex(uint64_t uid)
+    {
+        size_t i = Hash(uid);
+        while (m_index[i].slot == EMPTY || m_index[i].uid != uid)
+        {
+            i = (i + 1) & m_mask;
+        }
+        size_t j = i;
+        while (true)
+        {
+            j = (j + 1) & m_mask;
+            if (m_index[j].slot == EMPTY)
+            {
+                break;
+            }
+            // The entry at j may fill the hole at i unless its home bucket
+            // lies cyclically in (i, j]
+            size_t home = Hash(m_index[j].uid);
+            bool stays = (i < j) ? (i < home && home <= j) : (i < home || home <= j);
+            if (!stays)
+            {
+                m_index[i] = m_index[j];
+                i = j;
+            }
+        }
+        m_index[i].slot = EMPTY;
+    }
+
+    void Rehash(size_t capacity)
+    {
+        m_index.assign(capacity, Bucket{0, EMPTY});
+        m_mask = capacity - 1;
+        for (uint32_t slot = 0; slot < m_records.size(); ++slot)
+        {
+            size_t i = Hash(m_records[slot].uid);
+            while (m_index[i].slot != EMPTY)
+            {
+                i = (i + 1) & m_mask;
+            }
+            m_index[i].uid = m_records[slot].uid;
+            m_index[i].slot = slot;
+        }
+    }
+
+    uint32_t m_nGateways = 0;
+    uint32_t m_wordsPerSlot = 0;
+    size_t m_mask = 0;
+    std::vector<Bucket> m_index;
+    std::vector<PacketRecord> m_records;
+    std::vector<uint64_t> m_outcomes;
+    std::vector<DeviceAggregate> m_deviceAggregates;
+    std::vector<GatewayAggregate> m_gatewayAggregates;
+};
+
+} // namespace ns3
+
+#endif /* PACKET_STATUS_TRACKER_H */
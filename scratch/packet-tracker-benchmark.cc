@@ -0,0 +1,213 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+/*
+ * Replays the packet tracker callback path (one transmission followed by one
+ * outcome per gateway, then the per-window reset) on the std::map tracker and
+ * on the UID-keyed PacketStatusTracker, and prints the time spent by each.
+ *
+ * ./ns3 run "scratch/packet-tracker-benchmark --nDevices=10000 --nGateways=10"
+ */
+
+#include "packet-status-tracker.h"
+
+#include "ns3/command-line.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("PacketTrackerBenchmark");
+
+struct myPacketStatus
+{
+    Ptr<const Packet> packet;
+    uint32_t senderId;
+    uint32_t receiverId;
+    Time sentTime;
+    Time receivedTime;
+    uint8_t senderSF;
+    uint8_t receiverSF;
+    double senderTP;
+    double receiverTP;
+    uint32_t outcomeNumber;
+    std::vector<enum PacketOutcome> outcomes;
+};
+
+uint32_t nDevices = 1000;
+uint32_t nGateways = 5;
+uint64_t checksum = 0;
+
+std::map<Ptr<const Packet>, myPacketStatus> mapTracker;
+PacketStatusTracker flatTracker;
+
+void
+MapCheckComplete(std::map<Ptr<const Packet>, myPacketStatus>::iterator it)
+{
+    if ((*it).second.outcomeNumber == nGateways)
+    {
+        myPacketStatus status = (*it).second;
+        for (uint32_t j = 0; j < nGateways; j++)
+        {
+            checksum += status.outcomes.at(j);
+        }
+    }
+}
+
+void
+MapTransmission(Ptr<const Packet> packet, uint32_t systemId)
+{
+    myPacketStatus status;
+    status.packet = packet;
+    status.senderId = systemId;
+    status.sentTime = Simulator::Now();
+    status.outcomeNumber = 0;
+    status.outcomes = std::vector<enum PacketOutcome>(nGateways, _UNSET);
+    mapTracker.insert(std::pair<Ptr<const Packet>, myPacketStatus>(packet, status));
+}
+
+void
+MapOutcome(Ptr<const Packet> packet, uint32_t systemId, PacketOutcome outcome)
+{
+    auto it = mapTracker.find(packet);
+    if (it != mapTracker.end())
+    {
+        (*it).second.outcomes.at(systemId - nDevices) = outcome;
+        (*it).second.outcomeNumber += 1;
+        MapCheckComplete(it);
+    }
+}
+
+void
+FlatCheckComplete(uint32_t slot)
+{
+    if (flatTracker.Get(slot).outcomeNumber == nGateways)
+    {
+        for (uint32_t j = 0; j < nGateways; j++)
+        {
+            checksum += flatTracker.GetOutcome(slot, j);
+        }
+    }
+}
+
+void
+FlatTransmission(Ptr<const Packet> packet, uint32_t systemId)
+{
+    PacketRecord& status = flatTracker.Get(flatTracker.Insert(packet->GetUid()));
+    status.senderId = systemId;
+    status.size = packet->GetSize();
+    status.sentTime = Simulator::Now();
+}
+
+void
+FlatOutcome(Ptr<const Packet> packet, uint32_t systemId, PacketOutcome outcome)
+{
+    uint32_t slot = flatTracker.Find(packet->GetUid());
+    if (slot != PacketStatusTracker::NOT_FOUND)
+    {
+        flatTracker.SetOutcome(slot, systemId - nDevices, outcome);
+        FlatCheckComplete(slot);
+    }
+}
+
+/**
+ * Runs the callback path over the given packets.
+ * @return elapsed seconds
+ */
+template <typename Tx, typename Out, typename Reset>
+double
+Replay(const std::vector<Ptr<Packet>>& packets, uint32_t nWindows, Tx tx, Out out, Reset reset)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t w = 0; w < nWindows; ++w)
+    {
+        reset();
+        for (uint32_t i = 0; i < packets.size(); ++i)
+        {
+            tx(packets[i], i % nDevices);
+        }
+        for (uint32_t i = 0; i < packets.size(); ++i)
+        {
+            for (uint32_t g = 0; g < nGateways; ++g)
+            {
+                out(packets[i], nDevices + g, PacketOutcome((i + g) % _UNSET));
+            }
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t nWindows = 5;
+    double windowTime = 600;
+    double applicationInterval = 10;
+
+    CommandLine cmd;
+    cmd.AddValue("nDevices", "Number of end devices", nDevices);
+    cmd.AddValue("nGateways", "Number of gateways", nGateways);
+    cmd.AddValue("nWindows", "Number of tracker reset windows", nWindows);
+    cmd.Parse(argc, argv);
+
+    uint32_t nPackets = nDevices * uint32_t(windowTime / applicationInterval);
+    std::vector<Ptr<Packet>> packets;
+    packets.reserve(nPackets);
+    for (uint32_t i = 0; i < nPackets; ++i)
+    {
+        packets.push_back(Create<Packet>(50));
+    }
+    flatTracker.SetGateways(nGateways);
+
+    double mapTime = Replay(
+        packets,
+        nWindows,
+        MapTransmission,
+        MapOutcome,
+        []() { mapTracker.clear(); });
+    uint64_t mapChecksum = checksum;
+    checksum = 0;
+    double flatTime = Replay(
+        packets,
+        nWindows,
+        FlatTransmission,
+        FlatOutcome,
+        []() { flatTracker.Clear(); });
+
+    uint64_t nCallbacks = uint64_t(nWindows) * nPackets * (1 + nGateways);
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "packets/window " << nPackets << " gateways " << nGateways << " windows "
+              << nWindows << std::endl;
+    std::cout << "std::map tracker: " << mapTime << " s, " << 1e9 * mapTime / nCallbacks
+              << " ns/callback" << std::endl;
+    std::cout << "flat tracker:     " << flatTime << " s, " << 1e9 * flatTime / nCallbacks
+              << " ns/callback" << std::endl;
+    std::cout << "speedup: " << mapTime / flatTime
+              << (mapChecksum == checksum ? "" : " (outcome mismatch!)") << std::endl;
+
+    Simulator::Destroy();
+    return 0;
+}
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Reader of the binary packet logs written by PacketLogWriter (packet-log-writer.h).
+
+As a module:
+    from packet_log import read_packet_log, outcomes
+    log = read_packet_log("transmissionPackets_1_10x1000.bin")  # numpy structured array
+    delay = log["receivedTime"] - log["sentTime"]
+    per_gateway = outcomes(log)  # (packets, gateways) array of 0..4 (_RECEIVED.._UNSET)
+
+As a script, converts a log to the text formats the drivers used to write:
+    python3 packet_log.py transmissionPackets_1_10x1000.bin > transmissionPackets_1_10x1000.dat
+    python3 packet_log.py --csv will_transmissionPackets_1_10x1000.bin
+    python3 packet_log.py --npy out.npy transmissionPackets_1_10x1000.bin
+"""
+
+import argparse
+import sys
+
+import numpy as np
+
+__author__ = "Rogério S. Silva"
+__copyright__ = "Copyright (c) 2023, NumbERS - Federal Institute of Goiás, Inhumas - IFG"
+__version__ = "0.1.0"
+__email__ = "rogerio.sousa@ifg.edu.br"
+
+MAGIC = 0x474f4c50
+VERSION = 1
+HEADER = np.dtype([("magic", "<u4"), ("version", "<u4"), ("nGateways", "<u4"), ("recordSize", "<u4")])
+FIXED_FIELDS = [("senderId", "<u4"), ("receiverId", "<u4"), ("sentTime", "<f8"), ("receivedTime", "<f8"),
+                ("senderSF", "u1"), ("receiverSF", "u1"), ("outcomeNumber", "<u2"), ("size", "<u4")]
+
+
+def read_packet_log(filename):
+    """
+    :return: structured array with one row per packet; the "outcomes" field holds the packed
+             4-bit outcomes and the number of gateways is in the array's dtype metadata
+    """
+    with open(filename, "rb") as f:
+        header = np.fromfile(f, dtype=HEADER, count=1)
+        if len(header) == 0 or header["magic"][0] != MAGIC or header["version"][0] != VERSION:
+            raise ValueError("%s is not a version %d packet log" % (filename, VERSION))
+        n_gateways = int(header["nGateways"][0])
+        words = (int(header["recordSize"][0]) - 32) // 8
+        dtype = np.dtype(FIXED_FIELDS + [("outcomes", "<u8", (words,))], metadata={"nGateways": n_gateways})
+        return np.fromfile(f, dtype=dtype)
+
+
+def outcomes(log):
+    """
+    :return: (packets, gateways) uint8 array of outcomes: 0 received, 1 interfered,
+             2 no more receivers, 3 under sensitivity, 4 unset
+    """
+    n_gateways = log.dtype.metadata["nGateways"]
+    words = log["outcomes"].reshape(len(log), -1)
+    nibbles = (words[:, :, None] >> (4 * np.arange(16, dtype=np.uint64))) & 0xF
+    return nibbles.reshape(len(log), -1)[:, :n_gateways].astype(np.uint8)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Converts a binary packet log to text or numpy")
+    parser.add_argument("log", help="log written by PacketLogWriter")
+    parser.add_argument("--csv", action="store_true",
+                        help="device,gateway,delay,throughput lines instead of the .dat columns")
+    parser.add_argument("--npy", metavar="FILE", help="save the structured array to FILE instead of printing")
+    args = parser.parse_args()
+
+    log = read_packet_log(args.log)
+    if args.npy:
+        np.save(args.npy, log)
+        return
+    # Records are logged once complete, sort them back in transmission order
+    log = log[np.argsort(log["sentTime"], kind="stable")]
+    delay = log["receivedTime"] - log["sentTime"]
+    out = sys.stdout
+    if args.csv:
+        out.write("device,gateway,delay,throughput\n")
+        with np.errstate(divide="ignore"):
+            throughput = log["size"] * 8 / delay
+        for p, d, t in zip(log, delay, throughput):
+            out.write("%d,%d,%.6g,%.6g\n" % (p["senderId"], p["receiverId"], d, t))
+    else:
+        for p, d in zip(log, delay):
+            out.write("%d %d %.6g %.6g %.6g\n" % (p["senderId"], p["receiverId"], p["sentTime"],
+                                                  p["receivedTime"], d))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,231 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef PLACEMENT_PACK_H
+#define PLACEMENT_PACK_H
+
+#include "ns3/position-allocator.h"
+#include "ns3/vector.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+/**
+ * Positions of one placement inside a pack, x y z per node
+ */
+struct PlacementSpan
+{
+    const double* xyz;
+    uint32_t count;
+
+    Vector Get(uint32_t i) const
+    {
+        return Vector(xyz[3 * i], xyz[3 * i + 1], xyz[3 * i + 2]);
+    }
+};
+
+/**
+ * Read-only view of a placement pack built by pack_placements.py.
+ *
+ * A pack holds many "x y z" placement files (devices and gateways, for every
+ * seed and size) in one little-endian file:
+ *
+ *   header   magic "PPAK", version, number of entries, 0, index offset (uint64), 0 (uint64)
+ *   data     the positions of every placement as doubles, x y z per node
+ *   index    one 128-byte entry per placement, sorted by name:
+ *            name (112 bytes, NUL padded), data offset (uint64), nodes (uint32), 0
+ *
+ * The entries are named after the base name of the text file they come from,
+ * so a run looks up the file name it would have opened. The file is mapped,
+ * not read: a lookup is a binary search over the index and the positions are
+ * handed out in place.
+ */
+class PlacementPack
+{
+  public:
+    static constexpr uint32_t MAGIC = 0x4b415050; // "PPAK"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t NAME_SIZE = 112;
+
+    PlacementPack() = default;
+    PlacementPack(const PlacementPack&) = delete;
+    PlacementPack& operator=(const PlacementPack&) = delete;
+
+    ~PlacementPack()
+    {
+        Close();
+    }
+
+    /**
+     * Maps a pack file.
+     * @return false when the file cannot be mapped or is not a pack
+     */
+    bool Open(const std::string& filename)
+    {
+        Close();
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        void* base = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(Header))
+        {
+            base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (base == MAP_FAILED)
+        {
+            return false;
+        }
+        m_base = static_cast<const char*>(base);
+        m_size = st.st_size;
+        const Header* header = reinterpret_cast<const Header*>(m_base);
+        if (header->magic != MAGIC || header->version != VERSION ||
+            header->indexOffset + uint64_t(header->entries) * sizeof(Entry) > m_size)
+        {
+            Close();
+            return false;
+        }
+        m_index = reinterpret_cast<const Entry*>(m_base + header->indexOffset);
+        m_entries = header->entries;
+        return true;
+    }
+
+    bool IsOpen() const
+    {
+        return m_base != nullptr;
+    }
+
+    /**
+     * @param name: base name of the placement file
+     * @param span: set to the positions of the placement when found
+     * @return whether the pack holds the placement
+     */
+    bool Find(const std::string& name, PlacementSpan& span) const
+    {
+        uint32_t lo = 0;
+        uint32_t hi = m_entries;
+        while (lo < hi)
+        {
+            uint32_t mid = lo + (hi - lo) / 2;
+            int cmp = std::strncmp(m_index[mid].name, name.c_str(), NAME_SIZE);
+            if (cmp == 0)
+            {
+                if (m_index[mid].offset + 24 * uint64_t(m_index[mid].count) > m_size)
+                {
+                    return false;
+                }
+                span.xyz = reinterpret_cast<const double*>(m_base + m_index[mid].offset);
+                span.count = m_index[mid].count;
+                return true;
+            }
+            if (cmp < 0)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Positions of a placement file: taken from the pack when it holds the
+     * base name of the file, parsed from the file otherwise.
+     * @return the positions, none when the file cannot be read either
+     */
+    Ptr<ListPositionAllocator> Load(const std::string& filename) const
+    {
+        Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator>();
+        PlacementSpan span;
+        if (IsOpen() && Find(filename.substr(filename.find_last_of('/') + 1), span))
+        {
+            for (uint32_t i = 0; i < span.count; ++i)
+            {
+                allocator->Add(span.Get(i));
+            }
+            return allocator;
+        }
+        std::ifstream in_File(filename);
+        double x;
+        double y;
+        double z;
+        while (in_File >> x >> y >> z)
+        {
+            allocator->Add(Vector(x, y, z));
+        }
+        return allocator;
+    }
+
+    void Close()
+    {
+        if (m_base != nullptr)
+        {
+            munmap(const_cast<char*>(m_base), m_size);
+            m_base = nullptr;
+            m_index = nullptr;
+            m_entries = 0;
+        }
+    }
+
+  private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entries;
+        uint32_t reserved;
+        uint64_t indexOffset;
+        uint64_t reserved2;
+    };
+
+    struct Entry
+    {
+        char name[NAME_SIZE];
+        uint64_t offset;
+        uint32_t count;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 32, "pack header layout");
+    static_assert(sizeof(Entry) == 128, "pack index entry layout");
+
+    const char* m_base = nullptr;
+    size_t m_size = 0;
+    const Entry* m_index = nullptr;
+    uint32_t m_entries = 0;
+};
+
+} // namespace ns3
+
+#endif /* PLACEMENT_PACK_H */
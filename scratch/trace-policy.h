@@ -0,0 +1,93 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2023 UNIVERSIDADE FEDERAL DE GOIÁS
+ * Copyright (c) NumbERS - INSTITUTO FEDERAL DE GOIÁS - CAMPUS INHUMAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Rogério S. Silva <rogerio.sousa@ifg.edu.br>
+ */
+#ifndef TRACE_POLICY_H
+#define TRACE_POLICY_H
+
+#include "ns3/log.h"
+
+/*
+ * Compile-time switch for the diagnostics of the per-packet callbacks.
+ *
+ * Diagnostics are compiled in the debug build profile only, so the optimized
+ * experiment binaries (./ns3 configure --build-profile=optimized, which run as
+ * ns3.xx-<program>-optimized) carry neither the verbosity tests nor the
+ * message building. -DLORAWAN_TRACE=0 or -DLORAWAN_TRACE=1 overrides the
+ * profile.
+ */
+#ifndef LORAWAN_TRACE
+#ifdef NS3_BUILD_PROFILE_DEBUG
+#define LORAWAN_TRACE 1
+#else
+#define LORAWAN_TRACE 0
+#endif
+#endif
+
+namespace ns3
+{
+
+struct TraceEnabled
+{
+    static constexpr bool enabled = true;
+};
+
+struct TraceDisabled
+{
+    static constexpr bool enabled = false;
+};
+
+#if LORAWAN_TRACE
+typedef TraceEnabled TracePolicy;
+#else
+typedef TraceDisabled TracePolicy;
+#endif
+
+} // namespace ns3
+
+/**
+ * NS_LOG_INFO that only exists when the trace policy is enabled. The message
+ * is neither built nor tested otherwise.
+ */
+#define TRACE_INFO(msg)                                                                            \
+    do                                                                                             \
+    {                                                                                              \
+        if constexpr (ns3::TracePolicy::enabled)                                                   \
+        {                                                                                          \
+            NS_LOG_INFO(msg);                                                                      \
+        }                                                                                          \
+    } while (false)
+
+/**
+ * TRACE_INFO guarded by a runtime verbosity flag, which is only tested when
+ * the trace policy is enabled.
+ */
+#define TRACE_INFO_IF(flag, msg)                                                                   \
+    do                                                                                             \
+    {                                                                                              \
+        if constexpr (ns3::TracePolicy::enabled)                                                   \
+        {                                                                                          \
+            if (flag)                                                                              \
+            {                                                                                      \
+                NS_LOG_INFO(msg);                                                                  \
+            }                                                                                      \
+        }                                                                                          \
+    } while (false)
+
+#endif /* TRACE_POLICY_H */
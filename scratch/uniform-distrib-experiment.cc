@@ -37,6 +37,13 @@
 #include "ns3/forwarder-helper.h"
 #include "ns3/lorawan-module.h"
 #include "ns3/propagation-module.h"
+#include "coverage-evaluator.h"
+#include "fork-server.h"
+#include "gateway-batch.h"
+#include "gateway-outcome-recorder.h"
+#include "packet-log-writer.h"
+#include "placement-pack.h"
+#include "trace-policy.h"
 #include <algorithm>
 #include <ctime>
 #include <iomanip>
@@ -63,136 +70,49 @@ int underSensitivity = 0;
  *  Global Callbacks  *
  **********************/
 
-enum PacketOutcome { _RECEIVED, _INTERFERED, _NO_MORE_RECEIVERS, _UNDER_SENSITIVITY, _UNSET };
-
-struct myPacketStatus
-{
-  Ptr<Packet const> packet;
-  uint32_t senderId;
-  uint32_t receiverId;
-  Time sentTime;
-  Time receivedTime;
-  int outcomeNumber;
-  std::vector<enum PacketOutcome> outcomes;
-};
-
-std::map<Ptr<Packet const>, myPacketStatus> packetTracker;
+PacketStatusTracker packetTracker;
+std::vector<Ptr<GatewayOutcomeRecorder> > outcomeRecorders;
+PacketLogWriter packetLog;
+PlacementPack placementPack;
 
 void
-CheckReceptionByAllGWsComplete (std::map<Ptr<Packet const>, myPacketStatus>::iterator it)
+CheckReceptionByAllGWsComplete (uint32_t slot)
 {
-  // Check whether this packet is received by all gateways
-  if ((*it).second.outcomeNumber == nGateways)
+  // Called once this packet has an outcome at every gateway: update the statistics
+  for (uint32_t j = 0; j < packetTracker.GetGateways (); j++)
     {
-      // Update the statistics
-      myPacketStatus status = (*it).second;
-      for (int j = 0; j < nGateways; j++)
+      switch (packetTracker.GetOutcome (slot, j))
         {
-          switch (status.outcomes.at (j))
-            {
-              case _RECEIVED: {
-                received += 1;
-                break;
-              }
-              case _UNDER_SENSITIVITY: {
-                underSensitivity += 1;
-                break;
-              }
-              case _NO_MORE_RECEIVERS: {
-                noMoreReceivers += 1;
-                break;
-              }
-              case _INTERFERED: {
-                interfered += 1;
-                break;
-              }
-              case _UNSET: {
-                break;
-              }
-            }
+          case _RECEIVED: {
+            received += 1;
+            break;
+          }
+          case _UNDER_SENSITIVITY: {
+            underSensitivity += 1;
+            break;
+          }
+          case _NO_MORE_RECEIVERS: {
+            noMoreReceivers += 1;
+            break;
+          }
+          case _INTERFERED: {
+            interfered += 1;
+            break;
+          }
+          case _UNSET: {
+            break;
+          }
         }
-      // Remove the packet from the tracker
-      //      packetTracker.erase (it);
     }
+  packetLog.Write (packetTracker, slot);
+  packetTracker.Retire (slot);
 }
 
 void
 TransmissionCallback (Ptr<Packet const> packet, uint32_t systemId)
 {
-  NS_LOG_INFO ("Transmitted a packet from device " << systemId);
-  // Create a packetStatus
-  myPacketStatus status;
-  status.packet = packet;
-  status.senderId = systemId;
-  status.sentTime = Simulator::Now ();
-  status.outcomeNumber = 0;
-  status.outcomes = std::vector<enum PacketOutcome> (nGateways, _UNSET);
-
-  packetTracker.insert (std::pair<Ptr<Packet const>, myPacketStatus> (packet, status));
-}
-
-void
-PacketReceptionCallback (Ptr<Packet const> packet, uint32_t systemId)
-{
-  // Remove the successfully received packet from the list of sent ones
-  NS_LOG_INFO ("A packet was successfully received at gateway " << systemId);
-
-  std::map<Ptr<Packet const>, myPacketStatus>::iterator it = packetTracker.find (packet);
-  if ((*it).second.outcomes.size () > systemId - nDevices)
-    {
-      (*it).second.outcomes.at (systemId - nDevices) = _RECEIVED;
-      (*it).second.outcomeNumber += 1;
-
-      //      if ((*it).second.outcomeNumber == 1 || (*it).second.receivedTime == Seconds (0))
-      if ((*it).second.receivedTime == Seconds (0))
-        {
-          (*it).second.receivedTime = Simulator::Now ();
-          (*it).second.receiverId = systemId;
-        }
-      CheckReceptionByAllGWsComplete (it);
-    }
-}
-
-void
-InterferenceCallback (Ptr<Packet const> packet, uint32_t systemId)
-{
-  // NS_LOG_INFO ("A packet was lost because of interference at gateway " << systemId);
-
-  std::map<Ptr<Packet const>, myPacketStatus>::iterator it = packetTracker.find (packet);
-  if ((*it).second.outcomes.size () > systemId - nDevices)
-    {
-      (*it).second.outcomes.at (systemId - nDevices) = _INTERFERED;
-      (*it).second.outcomeNumber += 1;
-    }
-  CheckReceptionByAllGWsComplete (it);
-}
-
-void
-NoMoreReceiversCallback (Ptr<Packet const> packet, uint32_t systemId)
-{
-  NS_LOG_INFO ("A packet was lost because there were no more receivers at gateway " << systemId);
-
-  std::map<Ptr<Packet const>, myPacketStatus>::iterator it = packetTracker.find (packet);
-  if ((*it).second.outcomes.size () > systemId - nDevices)
-    {
-      (*it).second.outcomes.at (systemId - nDevices) = _NO_MORE_RECEIVERS;
-      (*it).second.outcomeNumber += 1;
-    }
-  CheckReceptionByAllGWsComplete (it);
-}
-
-void
-UnderSensitivityCallback (Ptr<Packet const> packet, uint32_t systemId)
-{
-  NS_LOG_INFO ("A packet arrived at the gateway under sensitivity at gateway " << systemId);
-
-  std::map<Ptr<Packet const>, myPacketStatus>::iterator it = packetTracker.find (packet);
-  if ((*it).second.outcomes.size () > systemId - nDevices)
-    {
-      (*it).second.outcomes.at (systemId - nDevices) = _UNDER_SENSITIVITY;
-      (*it).second.outcomeNumber += 1;
-    }
-  CheckReceptionByAllGWsComplete (it);
+  TRACE_INFO ("Transmitted a packet from device " << systemId);
+  GatewayOutcomeRecorder::RecordTransmission (packetTracker, packet, systemId);
 }
 
 /**
@@ -203,25 +123,13 @@ UnderSensitivityCallback (Ptr<Packet const> packet, uint32_t systemId)
 void
 EndDevicesPlacement (std::string filename)
 {
-  double edX = 0.0, edY = 0.0, edZ = 0.0;
-  int nDev = 0;
-  Ptr<ListPositionAllocator> allocatorED = CreateObject<ListPositionAllocator> ();
-  const char *c = filename.c_str ();
-  // Get Devices position from File
-  std::ifstream in_File (c);
-  if (!in_File)
+  // From the placement pack when it holds this file
+  Ptr<ListPositionAllocator> allocatorED = placementPack.Load (filename);
+  int nDev = allocatorED->GetSize ();
+  if (nDev == 0)
     {
       std::cout << "Could not open the file - '" << filename << "'" << std::endl;
     }
-  else
-    {
-      while (in_File >> edX >> edY >> edZ)
-        {
-          allocatorED->Add (Vector (edX, edY, edZ));
-          nDev++;
-        }
-      in_File.close ();
-    }
 
   endDevices.Create (nDev);
   mobilityED.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
@@ -230,40 +138,90 @@ EndDevicesPlacement (std::string filename)
 }
 
 /**
-* Check if the number of gateways accomplishes to device's coverage rate.
+* Smallest subset of the gateways reaching a share of the devices at SF12: the reachability of
+* each device from each gateway is computed once, devices beyond the SF12 range being pruned by
+* a grid, and the subset is the greedy set cover of CoverageEvaluator.
 * @param coverageRate :: expected coverage rate
 * @return pair<bool, int> :: whether coverage rate is achieved and the number of required gateways
 **/
-//std::pair<bool, int>
-//NodeCoverage (double coverageRate)
-//{
-//  int reached = 0, requiredGateways = 0;
-//  // checking node coverage
-//  const double sensitivity[6] = {-130.0, -132.5, -135.0, -137.5, -140.0, -142.5};
-//  for (NodeContainer::Iterator gw = gateways.Begin (); gw != gateways.End (); ++gw)
-//    {
-//      Ptr<Node> oGateway = *gw;
-//      reached = 0;
-//      for (NodeContainer::Iterator ed = endDevices.Begin (); ed != endDevices.End (); ++ed)
-//        {
-//          Ptr<Node> oDevice = *ed;
-//          Ptr<MobilityModel> mobGW = oGateway->GetObject<MobilityModel> ();
-//          Ptr<MobilityModel> mobED = oDevice->GetObject<MobilityModel> ();
-//          double rx = channel->GetRxPower (14, mobGW, mobED);
-//
-//          if (rx - sensitivity[5] > 0)
-//            {
-//              reached++;
-//            }
-//        }
-//      requiredGateways += 1;
-//      if (reached / endDevices.GetN () > coverageRate)
-//        break;
-//    }
-//  NS_LOG_INFO ("Required Gateways: " + std::to_string (requiredGateways) +
-//               " Coverage rate: " + std::to_string (reached / endDevices.GetN ()));
-//  return {reached / endDevices.GetN () > coverageRate, requiredGateways};
-//}
+std::pair<bool, int>
+NodeCoverage (double coverageRate)
+{
+  const double sensitivity[6] = {-130.0, -132.5, -135.0, -137.5, -140.0, -142.5};
+  std::vector<Ptr<MobilityModel> > mobED, mobGW;
+  std::vector<Vector> positionsED, positionsGW;
+  for (NodeContainer::Iterator ed = endDevices.Begin (); ed != endDevices.End (); ++ed)
+    {
+      mobED.push_back ((*ed)->GetObject<MobilityModel> ());
+      positionsED.push_back (mobED.back ()->GetPosition ());
+    }
+  for (NodeContainer::Iterator gw = gateways.Begin (); gw != gateways.End (); ++gw)
+    {
+      mobGW.push_back ((*gw)->GetObject<MobilityModel> ());
+      positionsGW.push_back (mobGW.back ()->GetPosition ());
+    }
+  if (mobED.empty ())
+    {
+      return {false, 0};
+    }
+
+  // SF12 range, from the loss model of the channel (decreasing with the distance), for the
+  // highest gateway and device: doubled while in reach, then bisected
+  double zGW = 0, zED = 0;
+  for (const Vector &p : positionsGW)
+    {
+      zGW = std::max (zGW, p.z);
+    }
+  for (const Vector &p : positionsED)
+    {
+      zED = std::max (zED, p.z);
+    }
+  Ptr<ConstantPositionMobilityModel> from = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<ConstantPositionMobilityModel> to = CreateObject<ConstantPositionMobilityModel> ();
+  from->SetPosition (Vector (0, 0, zED));
+  auto inReach = [&] (double d) {
+    to->SetPosition (Vector (d, 0, zGW));
+    return channel->GetRxPower (14, from, to) - sensitivity[5] > 0;
+  };
+  double lo = 0, hi = 1;
+  while (inReach (hi) && hi < 1e6)
+    {
+      lo = hi;
+      hi *= 2;
+    }
+  for (int i = 0; i < 50; ++i)
+    {
+      double mid = (lo + hi) / 2;
+      if (inReach (mid))
+        {
+          lo = mid;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  CoverageEvaluator coverage;
+  coverage.Build (positionsED, positionsGW, hi + 1, [&] (uint32_t g, uint32_t d) {
+    return channel->GetRxPower (14, mobED[d], mobGW[g]) - sensitivity[5] > 0;
+  });
+  std::vector<double> rates;
+  std::vector<uint32_t> picked = coverage.Cover (coverageRate, &rates);
+
+  // Coverage curve: the rate reached by the first k gateways picked
+  for (uint32_t k = 0; k < picked.size (); ++k)
+    {
+      Vector p = positionsGW[picked[k]];
+      std::cout << k + 1 << " " << rates[k] << " " << p.x << " " << p.y << " " << p.z
+                << std::endl;
+    }
+  double reached = rates.empty () ? 0 : rates.back ();
+  int requiredGateways = picked.size ();
+  NS_LOG_INFO ("Required Gateways: " + std::to_string (requiredGateways) +
+               " Coverage rate: " + std::to_string (reached));
+  return {reached >= coverageRate, requiredGateways};
+}
 
 void
 PrintEndDevicesParameters (std::string filename)
@@ -300,6 +258,11 @@ main (int argc, char *argv[])
   int seed = 1;
   bool up = false;
   int packetSize = 41;
+  std::string placementPackFile = "";
+  std::string gatewayFiles = "";
+  std::string gatewaySets = "";
+  uint32_t forkJobs = 0;
+  double coverageRate = 0;
 
   CommandLine cmd;
   cmd.AddValue ("nDevices", "Number of end devices to include in the simulation", nDevices);
@@ -309,8 +272,31 @@ main (int argc, char *argv[])
   cmd.AddValue ("printRates", "Whether to print result rates", printRates);
   cmd.AddValue ("seed", "Independent replications seed", seed);
   cmd.AddValue ("up", "Spread Factor UP", up);
+  cmd.AddValue ("placementPack", "Placement pack read instead of the placement files it holds",
+                placementPackFile);
+  cmd.AddValue ("gatewayFiles",
+                "Batch mode: comma-separated gateway placement files, each scored in its own "
+                "window against the same devices",
+                gatewayFiles);
+  cmd.AddValue ("gatewaySets",
+                "Fork server: comma-separated numbers of gateways, one child run per number "
+                "sharing the devices built by the parent",
+                gatewaySets);
+  cmd.AddValue ("coverageRate",
+                "Coverage only: smallest subset of the gateways reaching this share (0..1] of "
+                "the devices at SF12, printed instead of running the simulation",
+                coverageRate);
+  cmd.AddValue ("forkJobs", "Fork server: children running at a time, 0 for the number of CPUs",
+                forkJobs);
   cmd.Parse (argc, argv);
 
+  if (!placementPackFile.empty () && !placementPack.Open (placementPackFile))
+    {
+      NS_FATAL_ERROR ("Could not open the placement pack " << placementPackFile);
+    }
+  GatewayBatch batch;
+  batch.Load (gatewayFiles, placementPack);
+
   RngSeedManager::SetSeed (seed + 100);
 
   Config::SetDefault ("ns3::EndDeviceLorawanMac::DRControl", BooleanValue (true));
@@ -411,27 +397,68 @@ main (int argc, char *argv[])
       phy->TraceConnectWithoutContext ("StartSending", MakeCallback (&TransmissionCallback));
     }
 
+  /*******************************************
+  *  Fork server: one child per gateway set  *
+  *******************************************/
+
+  // The devices above are built once and shared copy-on-write by the children,
+  // each child goes on from here as a standalone run with its own nGateways
+  ForkServer forkServer (forkJobs);
+  std::vector<uint32_t> gatewaySetList = ForkServer::ParseList (gatewaySets);
+  if (!gatewaySetList.empty ())
+    {
+      int32_t replication = forkServer.Serve (gatewaySetList.size ());
+      if (replication == ForkServer::PARENT)
+        {
+          for (uint32_t i = 0; i < gatewaySetList.size (); ++i)
+            {
+              std::cout << gatewaySetList[i] << "x" << nDevices << " " << forkServer.GetResult (i)
+                        << (forkServer.GetStatus (i) == 0 ? "" : " (failed)") << std::endl;
+            }
+          Simulator::Destroy ();
+          return 0;
+        }
+      nGateways = gatewaySetList[replication];
+    }
+
   /*********************
   *  Create Gateways  *
   *********************/
 
   NS_LOG_INFO ("Creating gateways...");
 
-  gateways.Create (nGateways);
+  if (batch.GetSize () > 0)
+    {
+      batch.Create (gateways);
+    }
+  else
+    {
+      gateways.Create (nGateways);
 
-  mobilityGW.SetPositionAllocator ("ns3::UniformDiscPositionAllocator", "rho", DoubleValue (5000),
-                                   "X", DoubleValue (5000.0), "Y", DoubleValue (5000.0));
+      mobilityGW.SetPositionAllocator ("ns3::UniformDiscPositionAllocator", "rho",
+                                       DoubleValue (5000), "X", DoubleValue (5000.0), "Y",
+                                       DoubleValue (5000.0));
 
-  mobilityGW.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-  mobilityGW.Install (gateways);
+      mobilityGW.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+      mobilityGW.Install (gateways);
 
-  // Make it so that gateways are at a height 30m
-  for (NodeContainer::Iterator g = gateways.Begin (); g != gateways.End (); ++g)
+      // Make it so that gateways are at a height 30m
+      for (NodeContainer::Iterator g = gateways.Begin (); g != gateways.End (); ++g)
+        {
+          Ptr<MobilityModel> mob = (*g)->GetObject<MobilityModel> ();
+          Vector position = mob->GetPosition ();
+          position.z = 30;
+          mob->SetPosition (position);
+        }
+    }
+
+  if (coverageRate > 0)
     {
-      Ptr<MobilityModel> mob = (*g)->GetObject<MobilityModel> ();
-      Vector position = mob->GetPosition ();
-      position.z = 30;
-      mob->SetPosition (position);
+      std::pair<bool, int> coverage = NodeCoverage (coverageRate);
+      std::cout << "Required gateways: " << coverage.second
+                << (coverage.first ? "" : " (coverage rate not reached)") << std::endl;
+      Simulator::Destroy ();
+      return 0;
     }
 
   // Create a net device for each gateway
@@ -439,6 +466,11 @@ main (int argc, char *argv[])
   macHelper.SetDeviceType (LorawanMacHelper::GW);
   helper.Install (phyHelper, macHelper, gateways);
 
+  // One outcome recorder per gateway, replacing the four trace callbacks
+  outcomeRecorders = GatewayOutcomeRecorder::Install (
+      gateways, packetTracker, MakeNullCallback<void, uint32_t> (),
+      MakeCallback (&CheckReceptionByAllGWsComplete));
+
   // Placement output file
   std::string fileNS3 = "/home/rogerio/git/sim-res/datafile/uniform/placement/uniformPlacement_" +
                         std::to_string (seed) + "s+" + std::to_string (nDevices) + "d+" +
@@ -449,18 +481,6 @@ main (int argc, char *argv[])
 
   for (NodeContainer::Iterator g = gateways.Begin (); g != gateways.End (); ++g)
     {
-      Ptr<Node> object = *g;
-      // Get the device
-      Ptr<NetDevice> netDevice = object->GetDevice (0);
-      Ptr<LoraNetDevice> loraNetDevice = netDevice->GetObject<LoraNetDevice> ();
-      Ptr<GatewayLoraPhy> gwPhy = loraNetDevice->GetPhy ()->GetObject<GatewayLoraPhy> ();
-      gwPhy->TraceConnectWithoutContext ("ReceivedPacket", MakeCallback (&PacketReceptionCallback));
-      gwPhy->TraceConnectWithoutContext ("LostPacketBecauseInterference",
-                                         MakeCallback (&InterferenceCallback));
-      gwPhy->TraceConnectWithoutContext ("LostPacketBecauseNoMoreReceivers",
-                                         MakeCallback (&NoMoreReceiversCallback));
-      gwPhy->TraceConnectWithoutContext ("LostPacketBecauseUnderSensitivity",
-                                         MakeCallback (&UnderSensitivityCallback));
       Ptr<MobilityModel> mobility2 = (*g)->GetObject<MobilityModel> ();
       Vector position = mobility2->GetPosition ();
       devicesNS3File << position.x << " " << position.y << " " << position.z << std::endl;
@@ -513,8 +533,35 @@ main (int argc, char *argv[])
   *  Simulation  *
   ****************/
 
+  if (batch.GetSize () > 0)
+    {
+      // Batch mode: one result row per candidate gateway set instead of the run outputs
+      std::function<void ()> prepare;
+      if (up)
+        {
+          prepare = [&] () { macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel); };
+        }
+      batch.Run (gateways, appContainer, packetTracker, appStopTime, Minutes (10), prepare,
+                 std::cout);
+      Simulator::Destroy ();
+      return 0;
+    }
+
   Simulator::Stop (appStopTime + Minutes (10));
 
+  if (printRates)
+    {
+      // Binary packet log, written as packets complete (see packet_log.py)
+      std::string packs_filename = "/home/rogerio/git/sim-res/datafile"
+                                   "/uniform/results/packets/transmissionPackets_" +
+                                   std::to_string (seed) + "_" + std::to_string (nGateways) + "x" +
+                                   std::to_string (nDevices) + ".bin";
+      if (!packetLog.Open (packs_filename, gateways.GetN ()))
+        {
+          NS_FATAL_ERROR ("Could not create the packet log " << packs_filename);
+        }
+    }
+
   Simulator::Run ();
   NS_LOG_INFO ("Computing performance metrics...");
   if (printRates)
@@ -531,25 +578,13 @@ main (int argc, char *argv[])
       /**
        * Print PACKETS
        * **/
-      std::string packs_filename = "/home/rogerio/git/sim-res/datafile"
-                                   "/uniform/results/packets/transmissionPackets_" +
-                                   std::to_string (seed) + "_" + std::to_string (nGateways) + "x" +
-                                   std::to_string (nDevices) + ".dat";
-      const char *cPK = packs_filename.c_str ();
-      std::ofstream filePKT;
-      filePKT.open (cPK, std::ios::out);
-      for (std::map<Ptr<Packet const>, myPacketStatus>::iterator p = packetTracker.begin ();
-           p != packetTracker.end (); ++p)
+      // Complete packets were logged and retired during the run, the ones left
+      // were not reported by every gateway
+      for (uint32_t slot = 0; slot < packetTracker.GetSize (); ++slot)
         {
-          filePKT << (*p).second.senderId << " " << (*p).second.receiverId << " "
-                  << (*p).second.sentTime.GetSeconds () << " "
-                  << (*p).second.receivedTime.GetSeconds () << " "
-                  << (*p).second.receivedTime.GetSeconds () - (*p).second.sentTime.GetSeconds ()
-                  << std::endl;
+          packetLog.Write (packetTracker, slot);
         }
-      filePKT.close ();
-
-      //      std::cout << packs_filename;
+      packetLog.Close ();
     }
 
   Simulator::Destroy ();
@@ -602,5 +637,12 @@ main (int argc, char *argv[])
       fileG.close ();
     }
 
+  if (forkServer.IsChild ())
+    {
+      forkServer.Reply ("received " + std::to_string (received) + " interfered " +
+                        std::to_string (interfered) + " noMoreReceivers " +
+                        std::to_string (noMoreReceivers) + " underSensitivity " +
+                        std::to_string (underSensitivity));
+    }
   return 0;
 }
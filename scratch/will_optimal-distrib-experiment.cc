@@ -22,6 +22,12 @@
 #include "ns3/propagation-module.h"
 #include "ns3/simulator.h"
 
+#include "fork-server.h"
+#include "gateway-outcome-recorder.h"
+#include "packet-log-writer.h"
+#include "placement-pack.h"
+#include "trace-policy.h"
+
 #include <algorithm>
 #include <ctime>
 #include <fstream>
@@ -56,149 +62,49 @@ int underSensitivity = 0;
  *  Global Callbacks  *
  **********************/
 
-enum PacketOutcome
-{
-    _RECEIVED,
-    _INTERFERED,
-    _NO_MORE_RECEIVERS,
-    _UNDER_SENSITIVITY,
-    _UNSET
-};
-
-struct myPacketStatus
-{
-    Ptr<const Packet> packet;
-    uint32_t senderId;
-    uint32_t receiverId;
-    Time sentTime;
-    Time receivedTime;
-    int outcomeNumber;
-    std::vector<enum PacketOutcome> outcomes;
-};
-
-std::map<Ptr<const Packet>, myPacketStatus> packetTracker;
+PacketStatusTracker packetTracker;
+std::vector<Ptr<GatewayOutcomeRecorder>> outcomeRecorders;
+PacketLogWriter packetLog;
+PlacementPack placementPack;
 
 void
-CheckReceptionByAllGWsComplete(std::map<Ptr<const Packet>, myPacketStatus>::iterator it)
+CheckReceptionByAllGWsComplete(uint32_t slot)
 {
-    // Check whether this packet is received by all gateways
-    if ((*it).second.outcomeNumber == nGat)
+    // Called once this packet has an outcome at every gateway: update the statistics
+    for (uint32_t j = 0; j < packetTracker.GetGateways(); j++)
     {
-        // Update the statistics
-        myPacketStatus status = (*it).second;
-        for (int j = 0; j < nGat; j++)
+        switch (packetTracker.GetOutcome(slot, j))
         {
-            switch (status.outcomes.at(j))
-            {
-            case _RECEIVED: {
-                received += 1;
-                break;
-            }
-            case _UNDER_SENSITIVITY: {
-                underSensitivity += 1;
-                break;
-            }
-            case _NO_MORE_RECEIVERS: {
-                noMoreReceivers += 1;
-                break;
-            }
-            case _INTERFERED: {
-                interfered += 1;
-                break;
-            }
-            case _UNSET: {
-                break;
-            }
-            }
+        case _RECEIVED: {
+            received += 1;
+            break;
+        }
+        case _UNDER_SENSITIVITY: {
+            underSensitivity += 1;
+            break;
+        }
+        case _NO_MORE_RECEIVERS: {
+            noMoreReceivers += 1;
+            break;
+        }
+        case _INTERFERED: {
+            interfered += 1;
+            break;
+        }
+        case _UNSET: {
+            break;
         }
-        // Remove the packet from the tracker
-        //      packetTracker.erase (it);
-    }
-}
-
-void
-TransmissionCallback(Ptr<const Packet> packet, uint32_t systemId)
-{
-    NS_LOG_INFO("Transmitted a packet from device " << systemId);
-    // Create a packetStatus
-    myPacketStatus status;
-    status.packet = packet;
-    status.senderId = systemId;
-    status.sentTime = Simulator::Now();
-    status.outcomeNumber = 0;
-    status.outcomes = std::vector<enum PacketOutcome>(nGat, _UNSET);
-
-    packetTracker.insert(std::pair<Ptr<const Packet>, myPacketStatus>(packet, status));
-}
-
-void
-PacketReceptionCallback(Ptr<const Packet> packet, uint32_t systemId)
-{
-    // Remove the successfully received packet from the list of sent ones
-    NS_LOG_INFO("A packet was successfully received at gateway " << systemId);
-
-    std::map<Ptr<const Packet>, myPacketStatus>::iterator it = packetTracker.find(packet);
-    if ((*it).second.outcomes.size() > systemId - nDevices)
-    {
-        // lembre que o ID do gateways é enumerado após todos os devices, logo numero sequencial
-        //  do GW é contado subtraindo o nDevices. Ainda que os pacotes originados do mesmo device
-        //  no mesmo instante é recebido pelos gateways na área de alcance,
-        //  <e que essas duplicidades são removidas pela CheckReceptionByAllGWsComplete> sem certeza
-        //  nisso
-        (*it).second.outcomes.at(systemId - nDevices) = _RECEIVED;
-        (*it).second.outcomeNumber += 1;
-        //      if ((*it).second.outcomeNumber == 1 || (*it).second.receivedTime == Seconds (0))
-        if ((*it).second.receivedTime == Seconds(0))
-        {
-            (*it).second.receivedTime = Simulator::Now();
-            (*it).second.receiverId = systemId;
-            //          cc++;
         }
-
-        CheckReceptionByAllGWsComplete(it);
-    }
-}
-
-void
-InterferenceCallback(Ptr<const Packet> packet, uint32_t systemId)
-{
-    NS_LOG_INFO("A packet was lost because of interference at gateway " << systemId);
-
-    std::map<Ptr<const Packet>, myPacketStatus>::iterator it = packetTracker.find(packet);
-    if ((*it).second.outcomes.size() > systemId - nDevices)
-    {
-        (*it).second.outcomes.at(systemId - nDevices) = _INTERFERED;
-        (*it).second.outcomeNumber += 1;
-    }
-    CheckReceptionByAllGWsComplete(it);
-}
-
-void
-NoMoreReceiversCallback(Ptr<const Packet> packet, uint32_t systemId)
-{
-    NS_LOG_INFO("A packet was lost because there were no more receivers at gateway " << systemId);
-
-    std::map<Ptr<const Packet>, myPacketStatus>::iterator it = packetTracker.find(packet);
-    if ((*it).second.outcomes.size() > systemId - nDevices)
-    {
-        (*it).second.outcomes.at(systemId - nDevices) = _NO_MORE_RECEIVERS;
-        (*it).second.outcomeNumber += 1;
     }
-    CheckReceptionByAllGWsComplete(it);
+    packetLog.Write(packetTracker, slot);
+    packetTracker.Retire(slot);
 }
 
 void
-UnderSensitivityCallback(Ptr<const Packet> packet, uint32_t systemId)
+TransmissionCallback(Ptr<const Packet> packet, uint32_t systemId)
 {
-    NS_LOG_INFO("A packet arrived at the gateway under sensitivity" << systemId);
-
-    std::map<Ptr<const Packet>, myPacketStatus>::iterator it = packetTracker.find(packet);
-    if ((*it).second.outcomes.size() > systemId - nDevices)
-    {
-        (*it).second.outcomes.at(systemId - nDevices) = _UNDER_SENSITIVITY;
-        (*it).second.outcomeNumber += 1;
-    }
-    CheckReceptionByAllGWsComplete(it);
+    TRACE_INFO("Transmitted a packet from device " << systemId);
+    GatewayOutcomeRecorder::RecordTransmission(packetTracker, packet, systemId);
 }
 
 uint8_t
@@ -215,25 +121,13 @@ SFToDR(uint8_t sf)
 void
 EndDevicesPlacement(std::string filename)
 {
-    double edX = 0.0, edY = 0.0, edZ = 0.0;
-    int nDev = 0;
-    Ptr<ListPositionAllocator> allocatorED = CreateObject<ListPositionAllocator>();
-    const char* c = filename.c_str();
-    // Get Devices position from File
-    std::ifstream in_File(c);
-    if (!in_File)
+    // From the placement pack when it holds this file
+    Ptr<ListPositionAllocator> allocatorED = placementPack.Load(filename);
+    int nDev = allocatorED->GetSize();
+    if (nDev == 0)
     {
         std::cout << "Could not open the file - '" << filename << "'" << std::endl;
     }
-    else
-    {
-        while (in_File >> edX >> edY >> edZ)
-        {
-            allocatorED->Add(Vector(edX, edY, edZ));
-            nDev++;
-        }
-        in_File.close();
-    }
 
     endDevices.Create(nDev);
     mobilityED.SetMobilityModel("ns3::ConstantPositionMobilityModel");
@@ -345,6 +239,9 @@ main(int argc, char* argv[])
     int packetSize = 37;
     std::string gwPositionFile = "";
     std::string optFilePrefix = "";
+    std::string placementPackFile = "";
+    std::string gatewaySets = "";
+    uint32_t forkJobs = 0;
 
     CommandLine cmd;
     cmd.AddValue("nDevices", "Number of end devices to include in the simulation", nDevices);
@@ -356,8 +253,23 @@ main(int argc, char* argv[])
     cmd.AddValue("up", "Spread Factor UP", up);
     cmd.AddValue("gwPositionFile", "File with gateway positions", gwPositionFile);
     cmd.AddValue("optFilePrefix", "File with gateway positions", optFilePrefix);
+    cmd.AddValue("placementPack",
+                 "Placement pack read instead of the device placement files it holds",
+                 placementPackFile);
+    cmd.AddValue("gatewaySets",
+                 "Fork server: comma-separated numbers of gateways, one child run per number "
+                 "sharing the devices built by the parent",
+                 gatewaySets);
+    cmd.AddValue("forkJobs",
+                 "Fork server: children running at a time, 0 for the number of CPUs",
+                 forkJobs);
     cmd.Parse(argc, argv);
 
+    if (!placementPackFile.empty() && !placementPack.Open(placementPackFile))
+    {
+        NS_FATAL_ERROR("Could not open the placement pack " << placementPackFile);
+    }
+
     RngSeedManager::SetSeed(seed + 100);
 
     Config::SetDefault("ns3::EndDeviceLorawanMac::DRControl", BooleanValue(false));
@@ -449,6 +361,39 @@ main(int argc, char* argv[])
     macHelper.SetRegion(LorawanMacHelper::EU);
     helper.Install(phyHelper, macHelper, endDevices);
 
+    // Connect trace sources
+    for (NodeContainer::Iterator j = endDevices.Begin(); j != endDevices.End(); ++j)
+    {
+        Ptr<Node> node = *j;
+        Ptr<LoraNetDevice> loraNetDevice = node->GetDevice(0)->GetObject<LoraNetDevice>();
+        Ptr<LoraPhy> phy = loraNetDevice->GetPhy();
+        phy->TraceConnectWithoutContext("StartSending", MakeCallback(&TransmissionCallback));
+    }
+
+    /********************************************
+     *  Fork server: one child per gateway set  *
+     ********************************************/
+
+    // The devices above are built once and shared copy-on-write by the children,
+    // each child goes on from here as a standalone run with its own nGateways
+    ForkServer forkServer(forkJobs);
+    std::vector<uint32_t> gatewaySetList = ForkServer::ParseList(gatewaySets);
+    if (!gatewaySetList.empty())
+    {
+        int32_t replication = forkServer.Serve(gatewaySetList.size());
+        if (replication == ForkServer::PARENT)
+        {
+            for (uint32_t i = 0; i < gatewaySetList.size(); ++i)
+            {
+                std::cout << gatewaySetList[i] << "x" << nDevices << " " << forkServer.GetResult(i)
+                          << (forkServer.GetStatus(i) == 0 ? "" : " (failed)") << std::endl;
+            }
+            Simulator::Destroy();
+            return 0;
+        }
+        nGateways = gatewaySetList[replication];
+    }
+
     // Configuring devices
     Ptr<LoraPhy> phyED;
     Ptr<ClassAEndDeviceLorawanMac> macED;
@@ -486,15 +431,6 @@ main(int argc, char* argv[])
     }
     in_File.close();
 
-    // Connect trace sources
-    for (NodeContainer::Iterator j = endDevices.Begin(); j != endDevices.End(); ++j)
-    {
-        Ptr<Node> node = *j;
-        Ptr<LoraNetDevice> loraNetDevice = node->GetDevice(0)->GetObject<LoraNetDevice>();
-        Ptr<LoraPhy> phy = loraNetDevice->GetPhy();
-        phy->TraceConnectWithoutContext("StartSending", MakeCallback(&TransmissionCallback));
-    }
-
     /*********************
      *  Create Gateways  *
      *********************/
@@ -512,21 +448,12 @@ main(int argc, char* argv[])
     macHelper.SetDeviceType(LorawanMacHelper::GW);
     helper.Install(phyHelper, macHelper, gateways);
 
-    for (NodeContainer::Iterator g = gateways.Begin(); g != gateways.End(); ++g)
-    {
-        Ptr<Node> object = *g;
-        // Get the device
-        Ptr<NetDevice> netDevice = object->GetDevice(0);
-        Ptr<LoraNetDevice> loraNetDevice = netDevice->GetObject<LoraNetDevice>();
-        Ptr<GatewayLoraPhy> gwPhy = loraNetDevice->GetPhy()->GetObject<GatewayLoraPhy>();
-        gwPhy->TraceConnectWithoutContext("ReceivedPacket", MakeCallback(&PacketReceptionCallback));
-        gwPhy->TraceConnectWithoutContext("LostPacketBecauseInterference",
-                                          MakeCallback(&InterferenceCallback));
-        gwPhy->TraceConnectWithoutContext("LostPacketBecauseNoMoreReceivers",
-                                          MakeCallback(&NoMoreReceiversCallback));
-        gwPhy->TraceConnectWithoutContext("LostPacketBecauseUnderSensitivity",
-                                          MakeCallback(&UnderSensitivityCallback));
-    }
+    // One outcome recorder per gateway, replacing the four trace callbacks
+    outcomeRecorders =
+        GatewayOutcomeRecorder::Install(gateways,
+                                        packetTracker,
+                                        MakeNullCallback<void, uint32_t>(),
+                                        MakeCallback(&CheckReceptionByAllGWsComplete));
 
     NS_LOG_DEBUG("Completed configuration");
 
@@ -575,10 +502,23 @@ main(int argc, char* argv[])
 
     Simulator::Stop(appStopTime + Minutes(10));
 
+    std::string path_output = cwd + "/data/results/";
+
+    if (printRates)
+    {
+        // Binary packet log, written as packets complete (see packet_log.py --csv)
+        std::string packs_filename = path_output + optFilePrefix + "_transmissionPackets_" +
+                                     std::to_string(seed) + "_" + std::to_string(nGateways) + "x" +
+                                     std::to_string(nDevices) + ".bin";
+        if (!packetLog.Open(packs_filename, gateways.GetN()))
+        {
+            NS_FATAL_ERROR("Could not create the packet log " << packs_filename);
+        }
+    }
+
     Simulator::Run();
     NS_LOG_INFO("Computing performance metrics...");
 
-    std::string path_output = cwd + "/data/results/";
     if (printRates)
     {
         /**
@@ -593,26 +533,13 @@ main(int argc, char* argv[])
          * Print PACKETS
          * **/
 
-        std::string packs_filename = path_output + optFilePrefix + "_transmissionPackets_" +
-                                     std::to_string(seed) + "_" + std::to_string(nGateways) + "x" +
-                                     std::to_string(nDevices) + ".dat";
-        const char* cPK = packs_filename.c_str();
-        std::ofstream filePKT;
-        filePKT.open(cPK, std::ios::out);
-        filePKT << "device,gateway,delay,throughput" << std::endl;
-        for (std::map<Ptr<const Packet>, myPacketStatus>::iterator p = packetTracker.begin();
-             p != packetTracker.end();
-             ++p)
+        // Complete packets were logged and retired during the run, the ones left
+        // were not reported by every gateway
+        for (uint32_t slot = 0; slot < packetTracker.GetSize(); ++slot)
         {
-            filePKT << (*p).second.senderId << "," << (*p).second.receiverId << ","
-                    << (*p).second.receivedTime.GetSeconds() - (*p).second.sentTime.GetSeconds()
-                    << ","
-                    << ((*p).second.packet->GetSize() * 8) /
-                           ((*p).second.receivedTime.GetSeconds() -
-                            (*p).second.sentTime.GetSeconds())
-                    << std::endl;
+            packetLog.Write(packetTracker, slot);
         }
-        filePKT.close();
+        packetLog.Close();
     }
 
     Simulator::Destroy();
@@ -678,5 +605,12 @@ main(int argc, char* argv[])
     }
     //  std::cout << cc << std::endl;
     //  std::cout << packetTracker.size();
+    if (forkServer.IsChild())
+    {
+        forkServer.Reply("received " + std::to_string(received) + " interfered " +
+                         std::to_string(interfered) + " noMoreReceivers " +
+                         std::to_string(noMoreReceivers) + " underSensitivity " +
+                         std::to_string(underSensitivity));
+    }
     return 0;
 }